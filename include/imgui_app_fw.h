@@ -17,6 +17,220 @@ struct imgui_app_fw_interface
 	virtual mu::leaf::result<void> end_frame(ImVec4 clear_color) noexcept		= 0;
 	virtual mu::leaf::result<void> destroy() noexcept							= 0;
 
+	struct frame_statistics
+	{
+		uint64_t frames_rendered		= 0;   // frames where at least one viewport was drawn
+		uint64_t frames_skipped			= 0;   // frames where every viewport was unchanged
+		uint64_t viewports_rendered		= 0;
+		uint64_t viewports_skipped		= 0;
+		double	 record_ms				= 0.0; // CPU time recording viewports, moving average
+		double	 flush_ms				= 0.0; // CPU time blocked submitting/presenting, near zero while CPU and GPU overlap
+		uint64_t arena_high_water_bytes = 0;   // largest per-viewport frame arena use, including heap fallbacks
+		uint64_t arena_overflows		= 0;   // transient allocations that didn't fit the frame arena
+		uint64_t font_atlas_bytes		= 0;   // font texture memory, 1 byte per pixel with the alpha-only atlas
+		double	 font_upload_ms			= 0.0; // CPU time of the last font atlas upload, including the staging copy
+		double	 font_build_ms			= 0.0; // last atlas rasterization, or its load from the font cache
+		uint64_t dpi_font_atlas_bytes	= 0;   // atlases kept for viewports on high DPI monitors
+	};
+
+	// When enabled, viewports whose draw data hashes identical to the previous frame skip upload, render pass and present.
+	virtual mu::leaf::result<void>			   set_skip_unchanged_frames(bool enable) noexcept = 0;
+	virtual mu::leaf::result<frame_statistics> get_frame_statistics() noexcept				   = 0;
+
+	// After idle_frames frames without input, animation requests or pending uploads, pump() blocks for up to wait_timeout seconds. 0 disables.
+	virtual mu::leaf::result<void> set_idle_policy(uint32_t idle_frames, double wait_timeout) noexcept = 0;
+	// Keeps pump() from blocking for at least count more frames, call every frame while animating.
+	virtual mu::leaf::result<void> request_frames(uint32_t count) noexcept = 0;
+	// Thread-safe, wakes a blocked pump() so the next frame runs immediately.
+	virtual mu::leaf::result<void> wake() noexcept = 0;
+
+	struct frame_pacing_settings
+	{
+		float target_fps			= 0.0f;	 // 0 = unlimited (present still limits)
+		bool  match_monitor_refresh = false; // snap the frame interval to a multiple of the current monitor's refresh period
+		float unfocused_fps			= 0.0f;	 // cap while no platform window has focus, 0 = no cap
+		float iconified_fps			= 0.0f;	 // cap while the main window is minimized, 0 = no cap
+	};
+
+	struct frame_pacing_statistics
+	{
+		uint64_t frames				= 0;
+		double	 target_interval_ms = 0.0;
+		double	 mean_interval_ms	= 0.0; // over the last sample window
+		double	 jitter_mean_ms		= 0.0; // mean |actual - target|
+		double	 jitter_stddev_ms	= 0.0;
+		double	 jitter_max_ms		= 0.0;
+		uint64_t missed_deadlines	= 0;
+	};
+
+	// pump() sleeps (coarse sleep plus spin) until the next frame deadline derived from these settings.
+	virtual mu::leaf::result<void>					  set_frame_pacing(const frame_pacing_settings& settings) noexcept = 0;
+	virtual mu::leaf::result<frame_pacing_statistics> get_frame_pacing_statistics() noexcept						   = 0;
+
+	// Records every viewport's command buffer on a worker thread and submits them together. User draw callbacks then run on worker
+	// threads and must not touch state shared with other viewports.
+	virtual mu::leaf::result<void> set_parallel_viewport_recording(bool enable) noexcept = 0;
+
+	// Frames with more vertex + index data than a threshold copy their draw lists into mapped staging memory on worker threads.
+	virtual mu::leaf::result<void> set_parallel_geometry_upload(bool enable) noexcept = 0;
+
+	// Uploads 12 byte vertices (quarter pixel int16 positions, unorm16 UVs, RGBA8) instead of ImDrawVert when a frame fits that range.
+	virtual mu::leaf::result<void> set_compact_vertices(bool enable) noexcept = 0;
+
+	// Submits the whole UI as one multi-draw-indirect call, clipping in the fragment shader. Frames with user callbacks, or devices
+	// without multiDrawIndirect or drawIndirectFirstInstance, keep the per-command path.
+	virtual mu::leaf::result<void> set_indirect_draw(bool enable) noexcept = 0;
+
+	// Draws into a retained image, redrawing only the area whose draw commands changed since the last frame, and copies it to the
+	// swapchain. Frames where nothing changed skip render and present.
+	virtual mu::leaf::result<void> set_partial_redraw(bool enable) noexcept = 0;
+
+	struct layer_statistics
+	{
+		uint64_t layers	   = 0;
+		uint64_t bytes	   = 0; // layer texture memory, 4 bytes per pixel
+		uint64_t budget	   = 0;
+		uint64_t renders   = 0; // layer re-renders since init
+		uint64_t evictions = 0;
+	};
+
+	// Renders the window (by ImGuiWindow::ID) into an offscreen layer and composites it as one quad until its draw list, size or
+	// framebuffer scale changes. Windows with user callbacks, or that don't fit the budget, are drawn normally.
+	virtual mu::leaf::result<void>			   set_window_layer(ImGuiID window_id, bool enable) noexcept = 0;
+	virtual mu::leaf::result<void>			   set_layer_budget(uint64_t bytes) noexcept				 = 0;
+	virtual mu::leaf::result<layer_statistics> get_layer_statistics() noexcept							 = 0;
+
+	// Number of vertex/index/uniform buffer sets each viewport cycles through (1-3, default 2). With one set, uploading a frame
+	// has to wait for the GPU to finish drawing the previous one.
+	virtual mu::leaf::result<void> set_frames_in_flight(uint32_t count) noexcept = 0;
+
+	// end_frame() copies every viewport's draw data into a snapshot and returns, a dedicated thread records, submits and presents
+	// it. User draw callbacks then run on that thread. Window layers are disabled while it runs.
+	virtual mu::leaf::result<void> set_render_thread(bool enable) noexcept = 0;
+
+	struct allocator_statistics
+	{
+		static constexpr int k_size_classes = 9; // payloads of 16, 32, .. 4096 bytes
+
+		uint64_t allocations[k_size_classes + 1] = {};	 // per size class, the last entry counts blocks that went to malloc
+		uint64_t frees[k_size_classes + 1]		 = {};
+		uint64_t live_bytes						 = 0;	 // requested bytes currently allocated by ImGui
+		uint64_t slab_bytes						 = 0;	 // memory reserved by the pools
+		bool	 pooled							 = true;
+
+		// part of live_bytes by what holds it, read from the ImGui context's containers
+		uint64_t draw_list_bytes = 0; // command, index, vertex and path buffers of the windows' draw lists
+		uint64_t window_bytes	 = 0; // ImGuiWindow objects with their names and ID stacks
+		uint64_t storage_bytes	 = 0; // ImGuiStorage pairs of the windows' state and the window lookup
+	};
+
+	// ImGui's heap goes through thread-cached size-class pools by default. Disabling sends new allocations to malloc, blocks
+	// allocated before are still freed correctly.
+	virtual mu::leaf::result<void>				   set_pooled_imgui_allocator(bool enable) noexcept = 0;
+	virtual mu::leaf::result<allocator_statistics> get_allocator_statistics() noexcept				= 0;
+
+	// Uploads the font atlas as R8 coverage (GetTexDataAsAlpha8) instead of RGBA8, default off. Only for atlases whose custom rects
+	// hold no colored pixels (icons, images), those would be drawn white. The atlas is re-uploaded on the next frame.
+	virtual mu::leaf::result<void> set_alpha_font_atlas(bool enable) noexcept = 0;
+
+	struct glyph_cache_statistics
+	{
+		uint64_t pages		  = 0;
+		uint64_t glyphs		  = 0; // currently cached
+		uint64_t rasterized	  = 0; // since init
+		uint64_t evictions	  = 0;
+		uint64_t misses		  = 0; // glyphs that found no cell, they draw as the fallback glyph
+		uint64_t upload_bytes = 0;
+	};
+
+	// Reserves pages of 512x512 atlas pixels (0-64, default 0 = off) for glyphs missing from the baked glyph ranges. They are
+	// rasterized on first use, from characters typed into ImGui and text passed to request_glyphs(), and uploaded as sub-rects.
+	// Glyphs not drawn for a while are evicted when a page size class fills up. Changing the page count rebuilds the atlas.
+	virtual mu::leaf::result<void> set_glyph_cache_pages(uint32_t pages) noexcept = 0;
+	// Queues the glyphs of UTF-8 text for the next begin_frame(), call once before first drawing text outside the baked ranges.
+	// Requested glyphs count as used. Glyphs evicted after going undrawn for a while come back when requested again.
+	virtual mu::leaf::result<void>					 request_glyphs(const char* utf8_text) noexcept = 0;
+	virtual mu::leaf::result<glyph_cache_statistics> get_glyph_cache_statistics() noexcept			= 0;
+
+	// Converts the atlas to signed distance fields once at the fonts' base size, so text stays sharp under FontGlobalScale, zoom
+	// and DPI changes without rebuilding. Conversion runs on worker threads and is cached in sdf_cache in the cache directory.
+	virtual mu::leaf::result<void> set_sdf_fonts(bool enable) noexcept = 0;
+	// Directory of the on-disk font and SDF caches, created on the first write. Defaults to imgui_app_fw in the per-user cache
+	// directory (%LOCALAPPDATA% on Windows, ~/Library/Caches on macOS, $XDG_CACHE_HOME or ~/.cache elsewhere), empty disables
+	// caching. Applies to atlases built afterwards, call it before init() to cover the first one.
+	virtual mu::leaf::result<void> set_cache_directory(const char* path) noexcept = 0;
+
+	// Viewports drawing at 2x or more (framebuffer scale, times the monitor DPI with ImGuiConfigFlags_DpiEnableScaleFonts) sample a
+	// copy of the atlas rendered at that integer scale, built the first time one lands there. Default on, evicted after 30 s unused.
+	virtual mu::leaf::result<void> set_dpi_font_atlases(bool enable, double evict_after_seconds) noexcept = 0;
+
+	struct gpu_timing
+	{
+		uint64_t samples = 0; // in the rolling window of the last 512
+		double	 min_ms	 = 0.0;
+		double	 avg_ms	 = 0.0;
+		double	 p99_ms	 = 0.0;
+	};
+
+	struct gpu_timing_statistics
+	{
+		bool	   supported = false; // a viewport got a timestamp query pool, false on queues without timestamps
+		gpu_timing render_pass;		  // each viewport's UI pass, from the end of the work it waits for
+		gpu_timing user_callbacks;	  // each timed user callback, see mutable_userdata::m_timestamp_task
+	};
+
+	// Writes GPU timestamps around each viewport's UI render pass and the tasks user callbacks return, default off. Results
+	// are read back frames later without waiting, queries the GPU hasn't finished yet are dropped.
+	virtual mu::leaf::result<void>					set_gpu_profiling(bool enable) noexcept = 0;
+	virtual mu::leaf::result<gpu_timing_statistics> get_gpu_timing_statistics() noexcept	= 0;
+
+	enum class frame_phase : uint32_t
+	{
+		pump,			 // including the idle wait and frame pacing sleep
+		new_frame,		 // platform side of begin_frame(), contains the next three
+		update_monitors, // only on frames after a monitor change
+		update_mouse,	 // mouse position, buttons and cursor
+		update_gamepads,
+		imgui_new_frame,
+		ui_build,		 // application code between begin_frame() and end_frame()
+		imgui_render,
+		create_buffers,	 // per viewport, inside draw
+		draw,			 // per viewport, recording the UI pass
+		execute,		 // per command buffer handed to the frame graph
+		flush,			 // submit and present, the frame graph presents swapchain images while flushing
+		count
+	};
+
+	struct phase_statistics
+	{
+		static constexpr int k_histogram_buckets = 16; // bucket i counts samples under 2^(i-6) ms, the last one everything longer
+
+		bool	 available						= false; // false when built without IMGUI_APP_FW_CPU_PROFILER
+		uint64_t samples						= 0;
+		double	 p50_ms							= 0.0;
+		double	 p95_ms							= 0.0;
+		double	 p99_ms							= 0.0;
+		double	 max_ms							= 0.0;
+		uint32_t histogram[k_histogram_buckets] = {};
+	};
+
+	// Thread-safe, summarizes the samples of one phase that ended in the last window_seconds (<= 0 for all of them). Every phase
+	// keeps its last 2048 samples, phases timed per viewport or command buffer add one sample each.
+	virtual mu::leaf::result<phase_statistics> get_phase_statistics(frame_phase phase, double window_seconds) noexcept = 0;
+
+	// Records a timeline into a preallocated buffer for the next seconds (<= 0 until stop_trace()): frame phases and texture
+	// uploads and transcodes as zones on the thread that ran them, plus the GPU ranges of set_gpu_profiling(). The end_frame()
+	// after the window, or stop_trace(), writes it to json_path as Chrome trace event JSON for chrome://tracing or ui.perfetto.dev.
+	// Fails while a trace is running or without IMGUI_APP_FW_CPU_PROFILER. Off, each zone costs one relaxed atomic load.
+	virtual mu::leaf::result<void> start_trace(const char* json_path, double seconds) noexcept = 0;
+	virtual mu::leaf::result<void> stop_trace() noexcept									   = 0;
+
+	// Overlay in the main viewport's top-right corner: CPU frame time and, with set_gpu_profiling(), GPU time graphs over the last
+	// 120 frames against a 60 Hz budget, plus draw calls, frame graph tasks, vertices, uploads, texture memory, swapchain
+	// recreations and ImGui allocations per frame. toggle_key is a GLFW key code that flips it, 0 for none. No key is bound until
+	// this is called.
+	virtual mu::leaf::result<void> set_performance_hud(bool visible, int toggle_key) noexcept = 0;
+
 	struct mutable_userdata
 	{
 		mutable_userdata()			= default;
@@ -26,8 +240,12 @@ struct imgui_app_fw_interface
 		const FG::LogicalPassID	 m_pass_id;
 		void*					 m_original_user_data;
 		FG::Task				 m_task_result;
+		FG::Task				 m_timestamp_task; // set while GPU profiling, tasks depending on it are timed from their start
 
-		mutable_userdata(const FG::CommandBuffer* cmdbuf, const FG::LogicalPassID pass_id) : m_cmdbuf{cmdbuf}, m_pass_id{pass_id}, m_original_user_data{nullptr} {}
+		mutable_userdata(const FG::CommandBuffer* cmdbuf, const FG::LogicalPassID pass_id, FG::Task timestamp_task = nullptr)
+			: m_cmdbuf{cmdbuf}, m_pass_id{pass_id}, m_original_user_data{nullptr}, m_timestamp_task{timestamp_task}
+		{
+		}
 
 		FG::Task call(const ImDrawList& cmd_list, const ImDrawCmd& cmd)
 		{
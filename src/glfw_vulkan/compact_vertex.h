@@ -0,0 +1,118 @@
+#pragma once
+
+#include <imgui.h>
+
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define IMGUI_APP_FW_SSE2 1
+#elif defined(__ARM_NEON) && defined(__aarch64__)
+#include <arm_neon.h>
+#define IMGUI_APP_FW_NEON 1
+#endif
+
+// 12 byte vertex: positions in quarter pixels relative to the viewport origin, unorm16 UVs, RGBA8 color.
+struct compact_vert
+{
+	int16_t	 pos[2];
+	uint16_t uv[2];
+	uint32_t col;
+};
+static_assert(sizeof(compact_vert) == 12);
+
+struct compact_vertex_packer
+{
+	static constexpr float k_pos_scale = 4.0f;
+	static constexpr float k_pos_min   = -32768.0f / k_pos_scale;
+	static constexpr float k_pos_max   = 32767.0f / k_pos_scale;
+
+	// Converts count vertices, returns false if a position or UV didn't fit (the output is then unusable).
+	static bool pack(const ImDrawVert* src, size_t count, compact_vert* dst, ImVec2 origin)
+	{
+		size_t i = 0;
+#if IMGUI_APP_FW_SSE2
+		static_assert(sizeof(ImDrawVert) == 20 && offsetof(ImDrawVert, uv) == 8 && offsetof(ImDrawVert, col) == 16);
+
+		// lanes are (pos.x, pos.y, uv.x, uv.y); UVs are biased by -32768 so the signed saturating pack covers the unorm16 range
+		const __m128  scale		   = _mm_setr_ps(k_pos_scale, k_pos_scale, 65535.0f, 65535.0f);
+		const __m128  bias		   = _mm_setr_ps(origin.x * k_pos_scale, origin.y * k_pos_scale, 32768.0f, 32768.0f);
+		const __m128  lo		   = _mm_setr_ps(origin.x + k_pos_min, origin.y + k_pos_min, 0.0f, 0.0f);
+		const __m128  hi		   = _mm_setr_ps(origin.x + k_pos_max, origin.y + k_pos_max, 1.0f, 1.0f);
+		const __m128i uv_flip	   = _mm_setr_epi16(0, 0, short(0x8000), short(0x8000), 0, 0, short(0x8000), short(0x8000));
+		__m128		  out_of_range = _mm_setzero_ps();
+
+		for (; i + 2 <= count; i += 2)
+		{
+			const __m128 a = _mm_loadu_ps(&src[i].pos.x);
+			const __m128 b = _mm_loadu_ps(&src[i + 1].pos.x);
+
+			out_of_range = _mm_or_ps(out_of_range, _mm_or_ps(_mm_cmplt_ps(a, lo), _mm_cmpgt_ps(a, hi)));
+			out_of_range = _mm_or_ps(out_of_range, _mm_or_ps(_mm_cmplt_ps(b, lo), _mm_cmpgt_ps(b, hi)));
+
+			const __m128i ia	 = _mm_cvtps_epi32(_mm_sub_ps(_mm_mul_ps(a, scale), bias));
+			const __m128i ib	 = _mm_cvtps_epi32(_mm_sub_ps(_mm_mul_ps(b, scale), bias));
+			const __m128i packed = _mm_xor_si128(_mm_packs_epi32(ia, ib), uv_flip);
+
+			_mm_storel_epi64(reinterpret_cast<__m128i*>(&dst[i]), packed);
+			_mm_storel_epi64(reinterpret_cast<__m128i*>(&dst[i + 1]), _mm_unpackhi_epi64(packed, packed));
+			dst[i].col	   = src[i].col;
+			dst[i + 1].col = src[i + 1].col;
+		}
+
+		if (_mm_movemask_ps(out_of_range) != 0)
+		{
+			return false;
+		}
+#elif IMGUI_APP_FW_NEON
+		const float32x4_t scale		   = {k_pos_scale, k_pos_scale, 65535.0f, 65535.0f};
+		const float32x4_t bias		   = {origin.x * k_pos_scale, origin.y * k_pos_scale, 0.0f, 0.0f};
+		const float32x4_t lo		   = {origin.x + k_pos_min, origin.y + k_pos_min, 0.0f, 0.0f};
+		const float32x4_t hi		   = {origin.x + k_pos_max, origin.y + k_pos_max, 1.0f, 1.0f};
+		uint32x4_t		  out_of_range = vdupq_n_u32(0);
+
+		for (; i < count; ++i)
+		{
+			const float32x4_t v = vld1q_f32(&src[i].pos.x);
+			out_of_range		= vorrq_u32(out_of_range, vorrq_u32(vcltq_f32(v, lo), vcgtq_f32(v, hi)));
+
+			const int32x4_t	 iv	 = vcvtnq_s32_f32(vsubq_f32(vmulq_f32(v, scale), bias));
+			const int16x4_t	 pos = vqmovn_s32(iv);
+			const uint16x4_t uv	 = vqmovun_s32(iv);
+
+			vst1_lane_u32(reinterpret_cast<uint32_t*>(dst[i].pos), vreinterpret_u32_s16(pos), 0);
+			vst1_lane_u32(reinterpret_cast<uint32_t*>(dst[i].uv), vreinterpret_u32_u16(uv), 1);
+			dst[i].col = src[i].col;
+		}
+
+		if (vmaxvq_u32(out_of_range) != 0)
+		{
+			return false;
+		}
+#endif
+		return pack_scalar(src + i, count - i, dst + i, origin);
+	}
+
+	// Reference conversion, also used for the vertices the SIMD loop leaves over.
+	static bool pack_scalar(const ImDrawVert* src, size_t count, compact_vert* dst, ImVec2 origin)
+	{
+		for (size_t i = 0; i < count; ++i)
+		{
+			const ImDrawVert& v = src[i];
+			if (v.pos.x < origin.x + k_pos_min || v.pos.x > origin.x + k_pos_max || v.pos.y < origin.y + k_pos_min || v.pos.y > origin.y + k_pos_max || v.uv.x < 0.0f ||
+				v.uv.x > 1.0f || v.uv.y < 0.0f || v.uv.y > 1.0f)
+			{
+				return false;
+			}
+
+			dst[i].pos[0] = int16_t(std::lround((v.pos.x - origin.x) * k_pos_scale));
+			dst[i].pos[1] = int16_t(std::lround((v.pos.y - origin.y) * k_pos_scale));
+			dst[i].uv[0]  = uint16_t(std::lround(v.uv.x * 65535.0f));
+			dst[i].uv[1]  = uint16_t(std::lround(v.uv.y * 65535.0f));
+			dst[i].col	  = v.col;
+		}
+		return true;
+	}
+};
@@ -3,6 +3,7 @@
 #include "../imgui_app_fw_impl.h"
 
 #include "VulkanDevice2.h"
+#include "compact_vertex.h"
 #include <Framework/Vulkan/VulkanSwapchain.h>
 #include <framegraph/FG.h>
 #include <framegraph/Shared/EnumUtils.h>
@@ -11,15 +12,38 @@
 #include <imgui.h>
 #include <imgui_internal.h>
 
+// a private stb_truetype for the glyph cache, imgui_draw.cpp keeps its own copy static too
+#define STBTT_STATIC
+#define STBTT_malloc(size, user_data) ((void)(user_data), IM_ALLOC(size))
+#define STBTT_free(ptr, user_data)	((void)(user_data), IM_FREE(ptr))
+#define STB_TRUETYPE_IMPLEMENTATION
+#include <imstb_truetype.h>
+
+#include <algorithm>
 #include <array>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <condition_variable>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <functional>
 #include <limits>
 #include <memory>
+#include <memory_resource>
+#include <mutex>
+#include <thread>
+#include <tuple>
 
 #include <GLFW/glfw3.h>
 #ifdef _WIN32
 #undef APIENTRY
 #define GLFW_EXPOSE_NATIVE_WIN32
 #include <GLFW/glfw3native.h> // for glfwGetWin32Window
+#ifndef CREATE_WAITABLE_TIMER_HIGH_RESOLUTION
+#define CREATE_WAITABLE_TIMER_HIGH_RESOLUTION 0x00000002 // Windows 10 1803, older SDKs lack the define
+#endif
 #endif
 
 #if defined(_WIN32) && !defined(IMGUI_DISABLE_WIN32_FUNCTIONS) && !defined(IMGUI_DISABLE_WIN32_DEFAULT_IME_FUNCTIONS) && !defined(__GNUC__)
@@ -159,6 +183,346 @@ namespace FG
 	};
 } // namespace FG
 
+#ifndef IMGUI_APP_FW_CPU_PROFILER
+#define IMGUI_APP_FW_CPU_PROFILER 1
+#endif
+
+static int64_t steady_clock_ns()
+{
+	return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+#if IMGUI_APP_FW_CPU_PROFILER
+// Timeline of the frame loop for a triggered window, written as Chrome trace event JSON. Events go into a buffer allocated
+// when recording starts, writers check one relaxed flag and return while nothing records.
+struct trace_recorder
+{
+	static constexpr size_t	  k_capacity	= size_t(1) << 18; // events per trace, 8 MB while recording
+	static constexpr uint32_t k_max_threads = 64;			   // named threads, later ones show up by number
+	static constexpr uint32_t k_gpu_thread	= 0;			   // events on the GPU timeline, their start is in GPU time
+
+	struct event
+	{
+		const char* m_name; // string literal
+		int64_t		m_start_ns;
+		int64_t		m_duration_ns;
+		uint32_t	m_thread;
+	};
+
+	static inline std::atomic<bool>		   s_recording{false};
+	static inline std::atomic<uint32_t>	   s_writers{0};
+	static inline std::atomic<size_t>	   s_next{0};
+	static inline std::unique_ptr<event[]> s_events;
+	static inline int64_t				   s_begin_ns = 0;
+	static inline int64_t				   s_end_ns	  = 0;
+	static inline std::string			   s_path;
+	static inline std::atomic<int64_t>	   s_gpu_offset_ns{std::numeric_limits<int64_t>::max()}; // GPU clock minus steady clock, upper bound
+
+	static inline std::atomic<uint32_t>	   s_thread_count{0};
+	static inline std::atomic<const char*> s_thread_names[k_max_threads];
+	static inline thread_local uint32_t	   t_thread = 0;
+
+	static bool active()
+	{
+		return s_recording.load(std::memory_order_relaxed);
+	}
+
+	static uint32_t thread_id()
+	{
+		if (t_thread == 0)
+		{
+			t_thread = s_thread_count.fetch_add(1, std::memory_order_relaxed) + 1;
+		}
+		return t_thread;
+	}
+
+	static void name_thread(const char* name)
+	{
+		if (const uint32_t id = thread_id(); id < k_max_threads)
+		{
+			s_thread_names[id].store(name, std::memory_order_relaxed);
+		}
+	}
+
+	// The writer count keeps finish() from freeing the buffer under a writer that saw s_recording set.
+	template<typename T_FILL>
+	static void add(int64_t timeline_ns, T_FILL&& fill)
+	{
+		if (!active())
+		{
+			return;
+		}
+
+		s_writers.fetch_add(1);
+		if (s_recording.load() && timeline_ns >= s_begin_ns && timeline_ns < s_end_ns)
+		{
+			if (const size_t index = s_next.fetch_add(1, std::memory_order_relaxed); index < k_capacity)
+			{
+				fill(s_events[index]);
+			}
+		}
+		s_writers.fetch_sub(1, std::memory_order_release);
+	}
+
+	static void add_cpu(const char* name, int64_t start_ns, int64_t end_ns)
+	{
+		add(start_ns, [&](event& e) { e = {name, start_ns, end_ns - start_ns, thread_id()}; });
+	}
+
+	// GPU ranges are read back frames later. GPU work can't start before its frame was recorded, so the smallest difference
+	// between a range's start and its frame's recording start bounds the clock offset, finish() applies it.
+	static void add_gpu(const char* name, int64_t gpu_start_ns, int64_t duration_ns, int64_t record_ns)
+	{
+		add(record_ns, [&](event& e) {
+			int64_t offset = s_gpu_offset_ns.load(std::memory_order_relaxed);
+			while (gpu_start_ns - record_ns < offset && !s_gpu_offset_ns.compare_exchange_weak(offset, gpu_start_ns - record_ns, std::memory_order_relaxed))
+			{
+			}
+			e = {name, gpu_start_ns, duration_ns, k_gpu_thread};
+		});
+	}
+
+	// records a CPU zone from construction to the end of the enclosing block, reading the clock only while recording
+	struct zone
+	{
+		const char* m_name;
+		int64_t		m_start_ns;
+
+		explicit zone(const char* name)
+			: m_name{name}, m_start_ns{active() ? steady_clock_ns() : 0}
+		{
+		}
+
+		~zone()
+		{
+			if (m_start_ns != 0)
+			{
+				add_cpu(m_name, m_start_ns, steady_clock_ns());
+			}
+		}
+	};
+
+	// Main thread only. seconds <= 0 records until finish().
+	static bool start(const char* path, double seconds)
+	{
+		if (s_events || !path)
+		{
+			return false;
+		}
+
+		s_events.reset(new (std::nothrow) event[k_capacity]);
+		if (!s_events)
+		{
+			return false;
+		}
+		s_path	   = path;
+		s_begin_ns = steady_clock_ns();
+		s_end_ns   = seconds > 0.0 ? s_begin_ns + int64_t(seconds * 1e9) : std::numeric_limits<int64_t>::max();
+		s_next.store(0, std::memory_order_relaxed);
+		s_gpu_offset_ns.store(std::numeric_limits<int64_t>::max(), std::memory_order_relaxed);
+		s_recording.store(true);
+		return true;
+	}
+
+	static bool window_ended()
+	{
+		return s_events && steady_clock_ns() >= s_end_ns;
+	}
+
+	// Main thread only. Stops recording, waits out writers that are mid-event and writes the file.
+	static bool finish()
+	{
+		if (!s_events)
+		{
+			return false;
+		}
+
+		s_recording.store(false);
+		while (s_writers.load(std::memory_order_acquire) != 0)
+		{
+			std::this_thread::yield();
+		}
+
+		const bool written = write(s_path, std::min(s_next.load(std::memory_order_relaxed), k_capacity));
+		s_events.reset();
+		return written;
+	}
+
+	static bool write(const std::string& path, size_t count)
+	{
+		std::ofstream file{path, std::ios::binary | std::ios::trunc};
+		if (!file)
+		{
+			return false;
+		}
+
+		const int64_t gpu_offset = s_gpu_offset_ns.load(std::memory_order_relaxed);
+		const size_t  dropped	 = s_next.load(std::memory_order_relaxed) - count;
+
+		char line[256];
+		file << "{\"displayTimeUnit\":\"ms\",\"otherData\":{\"dropped_events\":\"" << dropped << "\"},\"traceEvents\":[\n";
+		file << "{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":1,\"args\":{\"name\":\"CPU\"}},\n";
+		file << "{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":2,\"args\":{\"name\":\"GPU\"}}";
+
+		const uint32_t threads = std::min(s_thread_count.load(std::memory_order_relaxed) + 1, k_max_threads);
+		for (uint32_t id = 1; id < threads; ++id)
+		{
+			if (const char* name = s_thread_names[id].load(std::memory_order_relaxed))
+			{
+				std::snprintf(line, sizeof(line), ",\n{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":%u,\"args\":{\"name\":\"%s\"}}", id, name);
+				file << line;
+			}
+		}
+
+		for (size_t i = 0; i < count; ++i)
+		{
+			const event& e	 = s_events[i];
+			const bool	 gpu = e.m_thread == k_gpu_thread;
+			if (gpu && gpu_offset == std::numeric_limits<int64_t>::max())
+			{
+				continue;
+			}
+			const int64_t start = gpu ? e.m_start_ns - gpu_offset : e.m_start_ns;
+
+			// microseconds from the start of the window
+			std::snprintf(line, sizeof(line), ",\n{\"name\":\"%s\",\"ph\":\"X\",\"pid\":%d,\"tid\":%u,\"ts\":%.3f,\"dur\":%.3f}", e.m_name, gpu ? 2 : 1, e.m_thread,
+						  double(start - s_begin_ns) * 1e-3, double(e.m_duration_ns) * 1e-3);
+			file << line;
+		}
+		file << "\n]}\n";
+		return bool(file);
+	}
+};
+
+// Durations of the frame loop phases, one ring of samples per phase. Any thread can record: a writer claims a slot with a
+// relaxed fetch_add and fills it with relaxed stores, a reader racing it sees at worst one torn sample.
+struct cpu_profiler
+{
+	using phase = imgui_app_fw_interface::frame_phase;
+
+	static constexpr size_t k_ring_size	  = 2048;
+	static constexpr size_t k_phase_count = size_t(phase::count);
+
+	struct sample
+	{
+		std::atomic<int64_t>  m_end_ns		= 0; // steady clock time the phase ended, 0 while the slot is unused
+		std::atomic<uint32_t> m_duration_ns = 0;
+	};
+
+	struct ring
+	{
+		std::atomic<uint64_t>			m_head = 0;
+		std::array<sample, k_ring_size> m_samples;
+	};
+
+	static inline std::array<ring, k_phase_count> s_rings;
+
+	static constexpr const char* k_phase_names[k_phase_count] = {
+		"pump",
+		"new_frame",
+		"update_monitors",
+		"update_mouse",
+		"update_gamepads",
+		"ImGui::NewFrame",
+		"ui_build",
+		"ImGui::Render",
+		"create_buffers",
+		"draw",
+		"execute",
+		"flush"};
+
+	static void record(phase p, int64_t start_ns, int64_t end_ns)
+	{
+		ring&	r = s_rings[size_t(p)];
+		sample& s = r.m_samples[r.m_head.fetch_add(1, std::memory_order_relaxed) % k_ring_size];
+
+		s.m_duration_ns.store(uint32_t(std::clamp<int64_t>(end_ns - start_ns, 0, std::numeric_limits<uint32_t>::max())), std::memory_order_relaxed);
+		s.m_end_ns.store(end_ns, std::memory_order_relaxed);
+
+		trace_recorder::add_cpu(k_phase_names[size_t(p)], start_ns, end_ns);
+	}
+
+	// records the time from construction to the end of the enclosing block
+	struct scope
+	{
+		phase	m_phase;
+		int64_t m_start_ns = steady_clock_ns();
+
+		explicit scope(phase p)
+			: m_phase{p}
+		{
+		}
+
+		~scope()
+		{
+			record(m_phase, m_start_ns, steady_clock_ns());
+		}
+	};
+
+	static imgui_app_fw_interface::phase_statistics statistics(phase p, double window_seconds)
+	{
+		using statistics_t = imgui_app_fw_interface::phase_statistics;
+
+		statistics_t result;
+		result.available = true;
+
+		const int64_t					  oldest_ns = window_seconds > 0.0 ? steady_clock_ns() - int64_t(window_seconds * 1e9) : 1;
+		std::array<uint32_t, k_ring_size> durations;
+		size_t							  count = 0;
+
+		for (const sample& s : s_rings[size_t(p)].m_samples)
+		{
+			if (s.m_end_ns.load(std::memory_order_relaxed) >= oldest_ns)
+			{
+				durations[count++] = s.m_duration_ns.load(std::memory_order_relaxed);
+			}
+		}
+
+		if (count == 0)
+		{
+			return result;
+		}
+
+		std::sort(durations.begin(), durations.begin() + count);
+
+		const auto percentile = [&](size_t pct) { return double(durations[std::min(count - 1, count * pct / 100)]) * 1e-6; };
+
+		result.samples = count;
+		result.p50_ms  = percentile(50);
+		result.p95_ms  = percentile(95);
+		result.p99_ms  = percentile(99);
+		result.max_ms  = double(durations[count - 1]) * 1e-6;
+
+		// bucket limits double from 2^-6 ms, durations are sorted so the bucket only moves forward
+		int	   bucket	= 0;
+		double limit_ms = 1.0 / 64.0;
+		for (size_t i = 0; i < count; ++i)
+		{
+			const double ms = double(durations[i]) * 1e-6;
+			while (bucket < statistics_t::k_histogram_buckets - 1 && ms >= limit_ms)
+			{
+				++bucket;
+				limit_ms *= 2.0;
+			}
+			++result.histogram[bucket];
+		}
+		return result;
+	}
+};
+
+#define IMGUI_APP_FW_PROFILE_CONCAT2(a, b) a##b
+#define IMGUI_APP_FW_PROFILE_CONCAT(a, b)  IMGUI_APP_FW_PROFILE_CONCAT2(a, b)
+// Times the rest of the enclosing block as the given frame_phase
+#define IMGUI_APP_FW_PROFILE_SCOPE(name)   const cpu_profiler::scope IMGUI_APP_FW_PROFILE_CONCAT(profile_scope_, __LINE__){cpu_profiler::phase::name}
+// Adds the rest of the enclosing block to a running trace as a zone named by the string literal
+#define IMGUI_APP_FW_TRACE_SCOPE(name)	   const trace_recorder::zone IMGUI_APP_FW_PROFILE_CONCAT(trace_zone_, __LINE__){name}
+#define IMGUI_APP_FW_TRACE_THREAD(name)	   trace_recorder::name_thread(name)
+#else
+#define IMGUI_APP_FW_PROFILE_SCOPE(name) ((void)0)
+#define IMGUI_APP_FW_TRACE_SCOPE(name)	 ((void)0)
+#define IMGUI_APP_FW_TRACE_THREAD(name)	 ((void)0)
+#endif
+
 struct basis_cache
 {
 	struct basis_texture
@@ -197,6 +561,8 @@ struct basis_cache
 
 	void cache_basis_texture(std::wstring cache_key, uint32_t file_size, std::unique_ptr<std::byte[]> file_mem, const basist::transcoder_texture_format dest_format)
 	{
+		IMGUI_APP_FW_TRACE_SCOPE("basis transcode");
+
 		if (basist::basisu_transcoder transcoder(m_basis_codebook.get()); transcoder.validate_header(file_mem.get(), file_size))
 		{
 			auto new_texture			 = std::make_unique<basis_texture>();
@@ -315,6 +681,8 @@ struct basis_cache
 
 	std::optional<FG::Task> load_texture_from_cache(const std::wstring& cache_key, const FG::CommandBuffer& cmdbuf)
 	{
+		IMGUI_APP_FW_TRACE_SCOPE("basis upload");
+
 		if (auto itor = m_basis_cache.find(cache_key); itor != m_basis_cache.end())
 		{
 			if (auto& tex = std::get<1>(*itor); auto fg_format = convert_format(tex->format))
@@ -371,637 +739,5616 @@ struct basis_cache
 	}
 };
 
-struct imgui_renderer_window
+struct worker_pool
 {
-	FG::BufferID m_vertex_buffer;
-	FG::BufferID m_index_buffer;
-	FG::BufferID m_uniform_buffer;
-
-	FG::BytesU m_vertex_buf_size;
-	FG::BytesU m_index_buf_size;
+	using job_t = std::function<void(size_t)>;
 
-	FG::PipelineResources m_resources;
+	std::vector<std::thread> m_threads;
+	std::mutex				 m_mutex;
+	std::condition_variable	 m_wake;
+	std::condition_variable	 m_done;
 
-	std::map<ImTextureID, FG::ImageID> m_texture_cache;
-};
+	const job_t*		m_job		 = nullptr;
+	size_t				m_job_count	 = 0;
+	std::atomic<size_t> m_next_index = 0;
+	uint64_t			m_generation = 0;
+	size_t				m_busy		 = 0;
+	bool				m_quit		 = false;
 
-struct imgui_renderer
-{
-	FG::ImageID		m_font_texture;
-	FG::SamplerID	m_font_sampler;
-	FG::GPipelineID m_pipeline;
+	// set while the current thread runs a parallel_for item, nested parallel_for calls then run inline
+	static inline thread_local bool t_in_job = false;
 
-	bool init_shared(ImGuiContext* _context, const FG::FrameGraph& fg)
+	~worker_pool()
 	{
-		CHECK_ERR(create_pipeline(fg));
-		CHECK_ERR(create_sampler(fg));
-
-		// initialize font atlas
-		{
-			uint8_t* pixels;
-			int		 width, height;
-			_context->IO.Fonts->GetTexDataAsRGBA32(OUT & pixels, OUT & width, OUT & height);
-		}
-		return true;
+		stop();
 	}
 
-	bool init(imgui_renderer_window& pw, ImGuiContext* _context, const FG::FrameGraph& fg)
+	bool is_running() const
 	{
-		CHECK_ERR(init_pipeline(pw, fg));
-		return true;
+		return !m_threads.empty();
 	}
 
-	void destroy(imgui_renderer_window& pw, const FG::FrameGraph& fg)
+	void start(size_t thread_count)
 	{
-		if (fg)
+		stop();
+
+		// new workers start from generation 0, a count left over from the previous threads would run a stale job
+		m_quit		 = false;
+		m_generation = 0;
+		m_job		 = nullptr;
+		for (size_t i = 0; i < thread_count; ++i)
 		{
-			fg->ReleaseResource(INOUT pw.m_vertex_buffer);
-			fg->ReleaseResource(INOUT pw.m_index_buffer);
-			fg->ReleaseResource(INOUT pw.m_uniform_buffer);
+			m_threads.emplace_back([this]() { worker_loop(); });
 		}
 	}
 
-	void destroy_shared(const FG::FrameGraph& fg)
+	void stop()
 	{
-		if (fg)
 		{
-			fg->ReleaseResource(INOUT m_font_texture);
-			fg->ReleaseResource(INOUT m_font_sampler);
-			fg->ReleaseResource(INOUT m_pipeline);
+			std::lock_guard<std::mutex> lock(m_mutex);
+			m_quit = true;
+		}
+		m_wake.notify_all();
+
+		for (auto& t : m_threads)
+		{
+			t.join();
 		}
+		m_threads.clear();
 	}
 
-	template<typename T_USERDRAW_HANDLER>
-	FG::Task draw(
-		imgui_renderer_window& pw, ImDrawData* draw_data, ImGuiContext* _context, const FG::CommandBuffer& cmdbuf, FG::LogicalPassID pass_id, FG::ArrayView<FG::Task> dependencies,
-		T_USERDRAW_HANDLER userdraw_handler = [](const ImDrawList& cmd_list, const ImDrawCmd& cmd) -> FG::Task { return nullptr; })
+	// Runs job(0..count-1) across the workers and the calling thread, returns once every index has finished.
+	void parallel_for(size_t count, const job_t& job)
 	{
-		CHECK_ERR(cmdbuf and _context);
-
-		ASSERT(draw_data->TotalVtxCount > 0);
-
-		int fb_width  = (int)(draw_data->DisplaySize.x * draw_data->FramebufferScale.x);
-		int fb_height = (int)(draw_data->DisplaySize.y * draw_data->FramebufferScale.y);
-
-		if (fb_width <= 0 || fb_height <= 0)
+		if (m_threads.empty() || count <= 1 || t_in_job)
 		{
-			return nullptr;
+			for (size_t i = 0; i < count; ++i)
+			{
+				job(i);
+			}
+			return;
 		}
 
-		FG::SubmitRenderPass submit{pass_id};
-
-		submit.DependsOn(create_buffers(pw, draw_data, _context, cmdbuf));
-		submit.DependsOn(update_uniform_buffer(pw, draw_data, _context, cmdbuf));
-
-		for (auto dep : dependencies)
 		{
-			submit.DependsOn(dep);
+			std::lock_guard<std::mutex> lock(m_mutex);
+			m_job		= &job;
+			m_job_count = count;
+			m_next_index.store(0, std::memory_order_relaxed);
+			m_busy = m_threads.size();
+			++m_generation;
 		}
+		m_wake.notify_all();
 
-		FG::VertexInputState vert_input;
-		vert_input.Bind(FG::VertexBufferID(), FG::SizeOf<ImDrawVert>);
-		vert_input.Add(FG::VertexID("aPos"), FG::EVertexType::Float2, FG::OffsetOf(&ImDrawVert::pos));
-		vert_input.Add(FG::VertexID("aUV"), FG::EVertexType::Float2, FG::OffsetOf(&ImDrawVert::uv));
-		vert_input.Add(FG::VertexID("aColor"), FG::EVertexType::UByte4_Norm, FG::OffsetOf(&ImDrawVert::col));
+		run_items(job, count);
 
-		FG::uint idx_offset = 0;
-		FG::uint vtx_offset = 0;
+		std::unique_lock<std::mutex> lock(m_mutex);
+		m_done.wait(lock, [this]() { return m_busy == 0; });
+		m_job = nullptr;
+	}
 
-		ImVec2 clip_off	  = draw_data->DisplayPos;		 // (0,0) unless using multi-viewports
-		ImVec2 clip_scale = draw_data->FramebufferScale; // (1,1) unless using retina display which are often (2,2)
+	void run_items(const job_t& job, size_t count)
+	{
+		t_in_job = true;
+		for (size_t i = m_next_index.fetch_add(1, std::memory_order_relaxed); i < count; i = m_next_index.fetch_add(1, std::memory_order_relaxed))
+		{
+			job(i);
+		}
+		t_in_job = false;
+	}
 
-		pw.m_resources.BindBuffer(FG::UniformID("uPushConstant"), pw.m_uniform_buffer);
+	void worker_loop()
+	{
+		IMGUI_APP_FW_TRACE_THREAD("worker");
 
-		for (int i = 0; i < draw_data->CmdListsCount; ++i)
+		uint64_t seen_generation = 0;
+		for (;;)
 		{
-			const ImDrawList& cmd_list = *draw_data->CmdLists[i];
-
-			for (int j = 0; j < cmd_list.CmdBuffer.Size; ++j)
+			const job_t* job;
+			size_t		 count;
 			{
-				const ImDrawCmd& cmd = cmd_list.CmdBuffer[j];
-
-				if (cmd.UserCallback)
+				std::unique_lock<std::mutex> lock(m_mutex);
+				m_wake.wait(lock, [&]() { return m_quit || m_generation != seen_generation; });
+				if (m_quit)
 				{
-					if (cmd.UserCallback == ImDrawCallback_ResetRenderState)
-					{
-						// state is bound to the draw tasks, so this isn't needed?
-					}
-					else
-					{
-						submit.DependsOn(userdraw_handler(cmd_list, cmd));
-					}
+					return;
 				}
-				else
-				{
-					FG::RectI scissor;
-					scissor.left   = int((cmd.ClipRect.x - clip_off.x) * clip_scale.x);
-					scissor.top	   = int((cmd.ClipRect.y - clip_off.y) * clip_scale.y);
-					scissor.right  = int((cmd.ClipRect.z - clip_off.x) * clip_scale.x);
-					scissor.bottom = int((cmd.ClipRect.w - clip_off.y) * clip_scale.y);
-
-					if (scissor.left < fb_width && scissor.top < fb_height && scissor.right >= 0.0f && scissor.bottom >= 0.0f)
-					{
-						// Negative offsets are illegal for vkCmdSetScissor
-						if (scissor.left < 0)
-						{
-							scissor.left = 0;
-						}
-
-						if (scissor.top < 0)
-						{
-							scissor.top = 0;
-						}
+				seen_generation = m_generation;
+				job				= m_job;
+				count			= m_job_count;
+			}
 
-						if (cmd.TextureId)
-						{
-							// pw.m_resources.BindTexture(FG::UniformID("sTexture"), static_cast<FG::RawImageID>(cmd.TextureId), m_font_sampler);
-							pw.m_resources.BindTexture(FG::UniformID("sTexture"), m_font_texture, m_font_sampler);
-						}
-						else
-						{
-							pw.m_resources.BindTexture(FG::UniformID("sTexture"), m_font_texture, m_font_sampler);
-						}
+			run_items(*job, count);
 
-						cmdbuf->AddTask(
-							pass_id, FG::DrawIndexed{}
-										 .SetPipeline(m_pipeline)
-										 .AddResources(FG::DescriptorSetID{"0"}, pw.m_resources)
-										 .AddVertexBuffer(FG::VertexBufferID(), pw.m_vertex_buffer)
-										 .SetVertexInput(vert_input)
-										 .SetTopology(FG::EPrimitive::TriangleList)
-										 .SetIndexBuffer(pw.m_index_buffer, (FG::BytesU)0, FG::EIndex::UShort)
-										 .AddColorBuffer(FG::RenderTargetID::Color_0, FG::EBlendFactor::SrcAlpha, FG::EBlendFactor::OneMinusSrcAlpha, FG::EBlendOp::Add)
-										 .SetDepthTestEnabled(false)
-										 .SetCullMode(FG::ECullMode::None)
-										 .Draw(cmd.ElemCount, 1, idx_offset, int(vtx_offset), 0)
-										 .AddScissor(scissor));
-					}
-				}
-				idx_offset += cmd.ElemCount;
+			std::lock_guard<std::mutex> lock(m_mutex);
+			if (--m_busy == 0)
+			{
+				m_done.notify_one();
 			}
-
-			vtx_offset += cmd_list.VtxBuffer.Size;
 		}
-
-		return cmdbuf->AddTask(submit);
 	}
 
-	bool create_pipeline(const FG::FrameGraph& fg)
+	static size_t default_thread_count()
 	{
-		using namespace std::string_literals;
+		// leave the main thread its own core, it always participates in parallel_for
+		const size_t hw = std::thread::hardware_concurrency();
+		return std::min<size_t>(hw > 1 ? hw - 1 : 0, 7);
+	}
+};
 
-		FG::GraphicsPipelineDesc desc;
+// Bump allocator for per-frame transients, reset at the end of every frame. Allocations that don't fit the block fall back
+// to the heap and are counted, reset() then grows the block past the largest frame so the next ones stay off the heap.
+struct frame_arena final : std::pmr::memory_resource
+{
+	static constexpr size_t k_default_size = 64 * 1024;
 
-		desc.AddShader(FG::EShader::Vertex, FG::EShaderLangFormat::VKSL_100, "main", R"#(
-			#version 450 core
-			layout(location = 0) in vec2 aPos;
-			layout(location = 1) in vec2 aUV;
-			layout(location = 2) in vec4 aColor;
+	std::unique_ptr<std::byte[]> m_block;
+	size_t						 m_size			  = 0;
+	size_t						 m_used			  = 0;
+	size_t						 m_frame_overflow = 0; // bytes that went to the heap since the last reset
+	size_t						 m_high_water	  = 0; // largest frame seen, arena plus overflow bytes
+	uint64_t					 m_overflows	  = 0;
 
-			//layout(push_constant) uniform uPushConstant {
-			layout(set=0, binding=1, std140) uniform uPushConstant {
-				vec2 uScale;
-				vec2 uTranslate;
-			} pc;
+	explicit frame_arena(size_t size = k_default_size) : m_block{new std::byte[size]}, m_size{size} {}
 
-			out gl_PerVertex{
-				vec4 gl_Position;
-			};
+	// Everything allocated from the arena since the last reset must be dead by now.
+	void reset()
+	{
+		const size_t frame_bytes = m_used + m_frame_overflow;
 
-			layout(location = 0) out struct{
-				vec4 Color;
-				vec2 UV;
-			} Out;
+		m_high_water	 = std::max(m_high_water, frame_bytes);
+		m_used			 = 0;
+		m_frame_overflow = 0;
 
-			void main()
+		if (frame_bytes > m_size)
+		{
+			size_t size = m_size;
+			while (size < frame_bytes)
 			{
-				Out.Color = aColor;
-				Out.UV = aUV;
-				gl_Position = vec4(aPos*pc.uScale+pc.uTranslate, 0, 1);
-			})#"s);
-
-		desc.AddShader(FG::EShader::Fragment, FG::EShaderLangFormat::VKSL_100, "main", R"#(
-			#version 450 core
-			layout(location = 0) out vec4 out_Color0;
+				size *= 2;
+			}
+			m_block.reset(new std::byte[size]);
+			m_size = size;
+		}
+	}
 
-			layout(set=0, binding=0) uniform sampler2D sTexture;
+private:
+	bool owns(const void* p) const
+	{
+		const uintptr_t begin = uintptr_t(m_block.get());
+		return uintptr_t(p) >= begin && uintptr_t(p) < begin + m_size;
+	}
 
-			layout(location = 0) in struct{
-				vec4 Color;
-				vec2 UV;
-			} In;
+	void* do_allocate(size_t bytes, size_t alignment) override
+	{
+		const size_t offset = (m_used + alignment - 1) & ~(alignment - 1);
+		if (offset + bytes <= m_size)
+		{
+			m_used = offset + bytes;
+			return m_block.get() + offset;
+		}
 
-			void main()
-			{
-				out_Color0 = In.Color * texture(sTexture, In.UV.st);
-			})#"s);
+		++m_overflows;
+		m_frame_overflow += bytes;
+		return std::pmr::new_delete_resource()->allocate(bytes, alignment);
+	}
 
-		m_pipeline = fg->CreatePipeline(desc);
-		CHECK_ERR(m_pipeline);
-		return true;
+	void do_deallocate(void* p, size_t bytes, size_t alignment) override
+	{
+		// arena memory is reclaimed all at once by reset()
+		if (!owns(p))
+		{
+			std::pmr::new_delete_resource()->deallocate(p, bytes, alignment);
+		}
 	}
 
-	bool init_pipeline(imgui_renderer_window& pw, const FG::FrameGraph& fg)
+	bool do_is_equal(const std::pmr::memory_resource& other) const noexcept override
 	{
-		CHECK_ERR(fg->InitPipelineResources(m_pipeline, FG::DescriptorSetID("0"), OUT pw.m_resources));
-		return true;
+		return this == &other;
 	}
+};
 
-	bool create_sampler(const FG::FrameGraph& fg)
+// Size-class pools for Dear ImGui's heap. Every block carries a 16 byte header with its class and owning cache, so frees don't
+// need the size and the pooled/malloc switch can change while blocks from either side are alive. Each thread allocates from
+// its own cache, refilled from 64 KB slabs which stay reserved for the process lifetime. Blocks freed on another thread go
+// back to their owner's cache, and the cache of an exited thread is adopted by the next thread that allocates.
+struct imgui_allocator
+{
+	static constexpr size_t	  k_header_size	 = 16;
+	static constexpr int	  k_class_count	 = imgui_app_fw_interface::allocator_statistics::k_size_classes; // 16 .. 4096 byte payloads
+	static constexpr int	  k_malloc_class = k_class_count;
+	static constexpr size_t	  k_slab_size	 = 64 * 1024;
+	static constexpr uint32_t k_max_caches	 = 256; // threads beyond this go to malloc
+
+	struct block_header
 	{
-		FG::SamplerDesc desc;
-		desc.SetFilter(FG::EFilter::Linear, FG::EFilter::Linear, FG::EMipmapFilter::Linear);
-		desc.SetAddressMode(FG::EAddressMode::Repeat);
-		desc.SetLodRange(-1000.0f, 1000.0f);
+		uint32_t m_class;
+		uint32_t m_cache; // index of the owning cache in s_caches
+		uint64_t m_size;
+	};
+	static_assert(sizeof(block_header) == k_header_size);
 
-		m_font_sampler = fg->CreateSampler(desc);
-		CHECK_ERR(m_font_sampler);
-		return true;
+	struct free_block
+	{
+		free_block* m_next;
+	};
+
+	struct thread_cache
+	{
+		free_block*				 m_free[k_class_count]	 = {};
+		std::atomic<free_block*> m_remote[k_class_count] = {}; // freed by other threads, taken over once m_free runs dry
+		uint32_t				 m_index				 = 0;
+		thread_cache*			 m_next_idle			 = nullptr;
+	};
+
+	// Hands the thread's cache to the idle list when the thread exits. Blocks freed after that go to the cache as remote frees.
+	struct cache_release
+	{
+		bool m_armed; // written when the cache is taken, which constructs the thread_local and registers its destructor
+
+		~cache_release()
+		{
+			if (t_cache)
+			{
+				release_cache(t_cache);
+				t_cache = nullptr;
+			}
+			t_exited = true;
+		}
+	};
+
+	static inline thread_local thread_cache* t_cache  = nullptr;
+	static inline thread_local bool			 t_exited = false;
+	static inline thread_local cache_release t_release;
+
+	static inline std::mutex	s_caches_mutex;
+	static inline thread_cache* s_caches[k_max_caches] = {}; // written under the mutex before the first block of the cache exists
+	static inline uint32_t		s_cache_count		   = 0;
+	static inline thread_cache* s_idle_caches		   = nullptr;
+
+	static inline std::atomic<bool>		s_pooled{true};
+	static inline std::atomic<uint64_t> s_allocations[k_class_count + 1];
+	static inline std::atomic<uint64_t> s_frees[k_class_count + 1];
+	static inline std::atomic<uint64_t> s_live_bytes{0};
+	static inline std::atomic<uint64_t> s_slab_bytes{0};
+
+	static constexpr size_t class_size(int size_class)
+	{
+		return size_t(16) << size_class;
 	}
 
-	ND_ FG::Task create_font_texture(ImGuiContext* _context, const FG::CommandBuffer& cmdbuf)
+	static int find_class(size_t size)
 	{
-		if (m_font_texture)
+		int size_class = 0;
+		while (size_class < k_class_count && class_size(size_class) < size)
 		{
-			return null;
+			++size_class;
 		}
+		return size_class;
+	}
 
-		uint8_t* pixels;
-		int		 width, height;
+	// The calling thread's cache, null while the thread exits or once k_max_caches threads hold one.
+	static thread_cache* current_cache()
+	{
+		if (!t_cache && !t_exited)
+		{
+			t_cache = acquire_cache();
+			if (t_cache)
+			{
+				t_release.m_armed = true;
+			}
+		}
+		return t_cache;
+	}
 
-		_context->IO.Fonts->GetTexDataAsRGBA32(OUT & pixels, OUT & width, OUT & height);
+	static thread_cache* acquire_cache()
+	{
+		std::lock_guard<std::mutex> lock(s_caches_mutex);
+		if (thread_cache* cache = s_idle_caches)
+		{
+			s_idle_caches = cache->m_next_idle;
+			return cache;
+		}
 
-		size_t upload_size = width * height * 4 * sizeof(char);
+		if (s_cache_count == k_max_caches)
+		{
+			return nullptr;
+		}
 
-		m_font_texture = cmdbuf->GetFrameGraph()->CreateImage(
-			FG::ImageDesc{}
-				.SetDimension({FG::uint(width), FG::uint(height)})
-				.SetFormat(FG::EPixelFormat::RGBA8_UNorm)
-				.SetUsage(FG::EImageUsage::Sampled | FG::EImageUsage::TransferDst),
-			FG::Default, "UI.FontTexture");
-		CHECK_ERR(m_font_texture);
+		thread_cache* cache = new (std::nothrow) thread_cache;
+		if (cache)
+		{
+			cache->m_index			  = s_cache_count;
+			s_caches[s_cache_count++] = cache;
+		}
+		return cache;
+	}
 
-		return cmdbuf->AddTask(FG::UpdateImage{}.SetImage(m_font_texture).SetData(pixels, upload_size, FG::uint2{FG::int2{width, height}}));
+	// The cache keeps its free lists, caches are never deleted since blocks of theirs may still be alive anywhere.
+	static void release_cache(thread_cache* cache)
+	{
+		std::lock_guard<std::mutex> lock(s_caches_mutex);
+		cache->m_next_idle = s_idle_caches;
+		s_idle_caches	   = cache;
 	}
 
-	ND_ FG::Task create_buffers(imgui_renderer_window& pw, ImDrawData* draw_data, ImGuiContext* _context, const FG::CommandBuffer& cmdbuf)
+	static bool take_remote(thread_cache& cache, int size_class)
 	{
-		FG::FrameGraph fg		   = cmdbuf->GetFrameGraph();
-		FG::BytesU	   vertex_size = draw_data->TotalVtxCount * FG::SizeOf<ImDrawVert>;
-		FG::BytesU	   index_size  = draw_data->TotalIdxCount * FG::SizeOf<ImDrawIdx>;
+		cache.m_free[size_class] = cache.m_remote[size_class].exchange(nullptr, std::memory_order_acquire);
+		return cache.m_free[size_class] != nullptr;
+	}
+
+	static bool refill(thread_cache& cache, int size_class)
+	{
+		const size_t stride = class_size(size_class) + k_header_size;
+		const size_t count	= std::max<size_t>(k_slab_size / stride, 1);
 
-		if (not pw.m_vertex_buffer or vertex_size > pw.m_vertex_buf_size)
+		uint8_t* slab = static_cast<uint8_t*>(std::malloc(stride * count));
+		if (!slab)
 		{
-			fg->ReleaseResource(INOUT pw.m_vertex_buffer);
+			return false;
+		}
+		s_slab_bytes.fetch_add(stride * count, std::memory_order_relaxed);
 
-			pw.m_vertex_buf_size = vertex_size;
-			pw.m_vertex_buffer	 = fg->CreateBuffer(FG::BufferDesc{vertex_size, FG::EBufferUsage::TransferDst | FG::EBufferUsage::Vertex}, FG::Default, "UI.VertexBuffer");
+		for (size_t i = count; i-- > 0;)
+		{
+			free_block* block		 = reinterpret_cast<free_block*>(slab + i * stride);
+			block->m_next			 = cache.m_free[size_class];
+			cache.m_free[size_class] = block;
 		}
+		return true;
+	}
 
-		if (not pw.m_index_buffer or index_size > pw.m_index_buf_size)
+	static void* alloc(size_t size, void*)
+	{
+		thread_cache* cache		 = s_pooled.load(std::memory_order_relaxed) ? current_cache() : nullptr;
+		const int	  size_class = cache ? find_class(size) : k_malloc_class;
+
+		uint8_t* block = nullptr;
+		if (size_class == k_malloc_class)
+		{
+			block = static_cast<uint8_t*>(std::malloc(size + k_header_size));
+		}
+		else if (cache->m_free[size_class] || take_remote(*cache, size_class) || refill(*cache, size_class))
 		{
-			fg->ReleaseResource(INOUT pw.m_index_buffer);
+			free_block* head		  = cache->m_free[size_class];
+			cache->m_free[size_class] = head->m_next;
+			block					  = reinterpret_cast<uint8_t*>(head);
+		}
 
-			pw.m_index_buf_size = index_size;
-			pw.m_index_buffer	= fg->CreateBuffer(FG::BufferDesc{index_size, FG::EBufferUsage::TransferDst | FG::EBufferUsage::Index}, FG::Default, "UI.IndexBuffer");
+		if (!block)
+		{
+			return nullptr;
 		}
 
-		FG::BytesU vb_offset;
-		FG::BytesU ib_offset;
+		block_header header = {uint32_t(size_class), cache ? cache->m_index : 0, uint64_t(size)};
+		std::memcpy(block, &header, sizeof(header));
 
-		FG::Task last_task;
+		s_allocations[size_class].fetch_add(1, std::memory_order_relaxed);
+		s_live_bytes.fetch_add(size, std::memory_order_relaxed);
+		return block + k_header_size;
+	}
 
-		for (int i = 0; i < draw_data->CmdListsCount; ++i)
+	static void free(void* ptr, void*)
+	{
+		if (!ptr)
 		{
-			const ImDrawList& cmd_list = *draw_data->CmdLists[i];
+			return;
+		}
 
-			last_task = cmdbuf->AddTask(FG::UpdateBuffer{}.SetBuffer(pw.m_vertex_buffer).AddData(cmd_list.VtxBuffer.Data, cmd_list.VtxBuffer.Size, vb_offset).DependsOn(last_task));
-			last_task = cmdbuf->AddTask(FG::UpdateBuffer{}.SetBuffer(pw.m_index_buffer).AddData(cmd_list.IdxBuffer.Data, cmd_list.IdxBuffer.Size, ib_offset).DependsOn(last_task));
+		uint8_t*	 block = static_cast<uint8_t*>(ptr) - k_header_size;
+		block_header header;
+		std::memcpy(&header, block, sizeof(header));
 
-			vb_offset += cmd_list.VtxBuffer.Size * FG::SizeOf<ImDrawVert>;
-			ib_offset += cmd_list.IdxBuffer.Size * FG::SizeOf<ImDrawIdx>;
+		s_frees[header.m_class].fetch_add(1, std::memory_order_relaxed);
+		s_live_bytes.fetch_sub(header.m_size, std::memory_order_relaxed);
+
+		if (header.m_class == uint32_t(k_malloc_class))
+		{
+			std::free(block);
+			return;
 		}
 
-		ASSERT(vertex_size == vb_offset);
-		ASSERT(index_size == ib_offset);
-		return last_task;
+		thread_cache* owner = s_caches[header.m_cache];
+		free_block*	  freed = reinterpret_cast<free_block*>(block);
+		if (owner == t_cache)
+		{
+			freed->m_next				  = owner->m_free[header.m_class];
+			owner->m_free[header.m_class] = freed;
+			return;
+		}
+
+		// Another thread's block goes back to its owner, so a thread that frees what another one allocates doesn't collect
+		// blocks its owner then has to replace with new slabs.
+		std::atomic<free_block*>& remote = owner->m_remote[header.m_class];
+		free_block*				  head	 = remote.load(std::memory_order_relaxed);
+		do
+		{
+			freed->m_next = head;
+		} while (!remote.compare_exchange_weak(head, freed, std::memory_order_release, std::memory_order_relaxed));
 	}
 
-	ND_ FG::Task update_uniform_buffer(imgui_renderer_window& pw, ImDrawData* draw_data, ImGuiContext* _context, const FG::CommandBuffer& cmdbuf)
+	static imgui_app_fw_interface::allocator_statistics statistics()
 	{
-		if (not pw.m_uniform_buffer)
+		imgui_app_fw_interface::allocator_statistics stats;
+		for (int i = 0; i <= k_class_count; ++i)
 		{
-			pw.m_uniform_buffer =
-				cmdbuf->GetFrameGraph()->CreateBuffer(FG::BufferDesc{(FG::BytesU)16, FG::EBufferUsage::Uniform | FG::EBufferUsage::TransferDst}, FG::Default, "UI.UniformBuffer");
-			CHECK_ERR(pw.m_uniform_buffer);
+			stats.allocations[i] = s_allocations[i].load(std::memory_order_relaxed);
+			stats.frees[i]		 = s_frees[i].load(std::memory_order_relaxed);
 		}
+		stats.live_bytes = s_live_bytes.load(std::memory_order_relaxed);
+		stats.slab_bytes = s_slab_bytes.load(std::memory_order_relaxed);
+		stats.pooled	 = s_pooled.load(std::memory_order_relaxed);
+		return stats;
+	}
 
-		FG::float4 pc_data;
-		// scale:
-		pc_data[0] = 2.0f / (draw_data->DisplaySize.x * _context->IO.DisplayFramebufferScale.x);
-		pc_data[1] = 2.0f / (draw_data->DisplaySize.y * _context->IO.DisplayFramebufferScale.y);
-		// transform:
-		pc_data[2] = -1.0f - draw_data->DisplayPos.x * pc_data[0];
-		pc_data[3] = -1.0f - draw_data->DisplayPos.y * pc_data[1];
+	// What the context's larger containers hold, by capacity so the unused tails are included. Called on the ImGui thread.
+	static void add_category_bytes(const ImGuiContext& ctx, INOUT imgui_app_fw_interface::allocator_statistics& stats)
+	{
+		const auto storage_bytes = [](const ImGuiStorage& storage) {
+			return uint64_t(storage.Data.Capacity) * sizeof(*storage.Data.Data);
+		};
+
+		for (const ImGuiWindow* window : ctx.Windows)
+		{
+			const ImDrawList& draw_list = *window->DrawList;
 
-		return cmdbuf->AddTask(FG::UpdateBuffer{}.SetBuffer(pw.m_uniform_buffer).AddData(&pc_data, 1));
+			stats.draw_list_bytes += uint64_t(draw_list.CmdBuffer.Capacity) * sizeof(ImDrawCmd) + uint64_t(draw_list.IdxBuffer.Capacity) * sizeof(ImDrawIdx);
+			stats.draw_list_bytes += uint64_t(draw_list.VtxBuffer.Capacity) * sizeof(ImDrawVert) + uint64_t(draw_list._Path.Capacity) * sizeof(ImVec2);
+			stats.window_bytes += sizeof(ImGuiWindow) + std::strlen(window->Name) + 1 + uint64_t(window->IDStack.Capacity) * sizeof(ImGuiID);
+			stats.storage_bytes += storage_bytes(window->StateStorage);
+		}
+		stats.storage_bytes += storage_bytes(ctx.WindowsById);
 	}
 };
 
-struct platform_window_data
+struct draw_data_hasher
 {
-	GLFWwindow* m_window;
-	bool		m_window_owned;
-	int			m_ignore_window_pos_event_frame;
-	int			m_ignore_window_size_event_frame;
-
-	platform_window_data()
+	static inline uint64_t mix(uint64_t h)
 	{
-		m_window						 = NULL;
-		m_window_owned					 = false;
-		m_ignore_window_size_event_frame = m_ignore_window_pos_event_frame = -1;
+		h ^= h >> 33;
+		h *= 0xff51afd7ed558ccdull;
+		h ^= h >> 33;
+		h *= 0xc4ceb9fe1a85ec53ull;
+		h ^= h >> 33;
+		return h;
 	}
 
-	~platform_window_data()
+	static uint64_t hash_memory(const void* data, size_t size, uint64_t seed)
 	{
-		IM_ASSERT(m_window == NULL);
+		const uint8_t* bytes = static_cast<const uint8_t*>(data);
+		uint64_t	   h	 = seed ^ (uint64_t(size) * 0x9e3779b97f4a7c15ull);
+
+		size_t i = 0;
+		for (; i + sizeof(uint64_t) <= size; i += sizeof(uint64_t))
+		{
+			uint64_t word;
+			std::memcpy(&word, bytes + i, sizeof(word));
+			h = (h ^ mix(word)) * 0x9e3779b97f4a7c15ull;
+			h = (h << 27) | (h >> 37);
+		}
+
+		uint64_t tail = 0;
+		if (i < size)
+		{
+			std::memcpy(&tail, bytes + i, size - i);
+		}
+		return mix(h ^ tail);
 	}
-};
 
-struct platform_device_factory : public FGC::IVulkanSurface
-{
-	GLFWwindow* m_window;
+	// Returns false if the draw list contains user callbacks, whose output can change without the draw list changing.
+	static bool hash_list(const ImDrawList& cmd_list, uint64_t seed, OUT uint64_t& result)
+	{
+		struct cmd_key
+		{
+			ImVec4		ClipRect;
+			ImTextureID TextureId;
+			uint32_t	VtxOffset;
+			uint32_t	IdxOffset;
+			uint32_t	ElemCount;
+		};
 
-	platform_device_factory(GLFWwindow* wnd) : m_window{wnd} {}
+		uint64_t h = hash_memory(cmd_list.VtxBuffer.Data, cmd_list.VtxBuffer.Size * sizeof(ImDrawVert), seed);
+		h		   = hash_memory(cmd_list.IdxBuffer.Data, cmd_list.IdxBuffer.Size * sizeof(ImDrawIdx), h);
 
-	virtual ~platform_device_factory() {}
+		for (int j = 0; j < cmd_list.CmdBuffer.Size; ++j)
+		{
+			const ImDrawCmd& cmd = cmd_list.CmdBuffer[j];
 
-	FGC::ArrayView<const char*> GetRequiredExtensions() const override
-	{
-		uint32_t	 required_extension_count = 0;
-		const char** required_extensions	  = glfwGetRequiredInstanceExtensions(&required_extension_count);
+			if (cmd.UserCallback && cmd.UserCallback != ImDrawCallback_ResetRenderState)
+			{
+				return false;
+			}
 
-		return FGC::ArrayView<const char*>{required_extensions, required_extension_count};
+			cmd_key key;
+			std::memset(&key, 0, sizeof(key));
+			key.ClipRect  = cmd.ClipRect;
+			key.TextureId = cmd.TextureId;
+			key.VtxOffset = cmd.VtxOffset;
+			key.IdxOffset = cmd.IdxOffset;
+			key.ElemCount = cmd.ElemCount;
+
+			h = hash_memory(&key, sizeof(key), h);
+		}
+
+		result = h;
+		return true;
 	}
 
-	SurfaceVk_t Create(InstanceVk_t inst) const override
+	// Returns false if the draw data contains user callbacks, whose output can change without the draw lists changing.
+	static bool hash(const ImDrawData* draw_data, OUT uint64_t& result)
 	{
-		VkSurfaceKHR surf = VK_NULL_HANDLE;
-		glfwCreateWindowSurface(FGC::BitCast<VkInstance>(inst), m_window, nullptr, &surf);
-		return FGC::BitCast<SurfaceVk_t>(surf);
+		const float display[6] = {
+			draw_data->DisplayPos.x,
+			draw_data->DisplayPos.y,
+			draw_data->DisplaySize.x,
+			draw_data->DisplaySize.y,
+			draw_data->FramebufferScale.x,
+			draw_data->FramebufferScale.y};
+
+		uint64_t h = hash_memory(display, sizeof(display), uint64_t(draw_data->CmdListsCount));
+
+		for (int i = 0; i < draw_data->CmdListsCount; ++i)
+		{
+			if (!hash_list(*draw_data->CmdLists[i], h, OUT h))
+			{
+				return false;
+			}
+		}
+
+		result = h;
+		return true;
 	}
 };
 
-struct platform_renderer_data
+// Finds the framebuffer region whose content changed since the previous frame. Draw commands are matched by content and draw order
+// (draw list index and position in the list) rather than by vertex offsets, so a blinking cursor only damages its own command and
+// moving a window damages its old and new area. Raising a window changes the order of the lists it overlaps and damages them.
+struct damage_tracker
 {
-	bool m_is_primary{false};
-
-	FGC::VulkanDevice2::window_specific m_window_specific;
-	FG::SwapchainID						m_swapchain_id;
-	imgui_renderer_window				m_imgui_window;
-
-	struct shared_data
+	struct entry
 	{
-		FGC::UniquePtr<FGC::VulkanDevice2Initializer> m_device;
-		FG::FrameGraph								  m_frame_graph;
-		imgui_renderer								  m_imgui_renderer;
-		FG::Array<FG::Task>							  m_shared_tasks;
+		uint64_t  m_hash;
+		FG::RectI m_rect;
 	};
 
-	static inline shared_data m_shared;
+	std::vector<entry>	  m_previous;
+	std::vector<entry>	  m_current;
+	std::vector<uint32_t> m_rebased; // scratch for index hashing
+	float				  m_display[6] = {};
+	bool				  m_valid	   = false;
 
-	void init(ImGuiContext* imgui_context, ImGuiViewport* viewport, bool primary)
+	void invalidate()
 	{
-		auto window			 = (GLFWwindow*)viewport->PlatformHandle;
-		auto surface_factory = FGC::UniquePtr<FGC::IVulkanSurface>(new platform_device_factory(window));
+		m_valid = false;
+	}
 
-		if (primary)
+	static void add_rect(INOUT FG::RectI& dst, const FG::RectI& src)
+	{
+		if (src.left >= src.right || src.top >= src.bottom)
 		{
-			auto new_device			 = std::make_unique<FGC::VulkanDevice2Initializer>();
-			auto required_extensions = surface_factory->GetRequiredExtensions();
-			new_device->CreateInstance("app_name", "engine_name", new_device->GetRecomendedInstanceLayers(), required_extensions);
+			return;
+		}
 
-			m_window_specific.CreateInstance(surface_factory, new_device->GetVkInstance());
+		if (dst.left >= dst.right || dst.top >= dst.bottom)
+		{
+			dst = src;
+			return;
+		}
 
-			new_device->ChooseHighPerformanceDevice();
-			new_device->CreateLogicalDevice({{VK_QUEUE_GRAPHICS_BIT | VK_QUEUE_SPARSE_BINDING_BIT}, {VK_QUEUE_COMPUTE_BIT}, {VK_QUEUE_TRANSFER_BIT}}, true, true, FGC::Default);
+		dst.left   = std::min(dst.left, src.left);
+		dst.top	   = std::min(dst.top, src.top);
+		dst.right  = std::max(dst.right, src.right);
+		dst.bottom = std::max(dst.bottom, src.bottom);
+	}
 
-			FG::VulkanDeviceInfo vulkan_info;
-			{
-				vulkan_info.instance	   = FGC::BitCast<FG::InstanceVk_t>(new_device->GetVkInstance());
-				vulkan_info.physicalDevice = FGC::BitCast<FG::PhysicalDeviceVk_t>(new_device->GetVkPhysicalDevice());
-				vulkan_info.device		   = FGC::BitCast<FG::DeviceVk_t>(new_device->GetVkDevice());
+	// Returns false if the whole framebuffer has to be redrawn: first frame, display change or user callbacks.
+	// Otherwise damage is the union of changed areas in framebuffer pixels, empty if nothing changed.
+	bool update(const ImDrawData* draw_data, OUT FG::RectI& damage)
+	{
+		damage = FG::RectI{};
 
-				vulkan_info.maxStagingBufferMemory = ~FGC::BytesU(0);
-				vulkan_info.stagingBufferSize	   = FGC::BytesU{8 * 1024 * 1024};
+		const float display[6] = {
+			draw_data->DisplayPos.x,
+			draw_data->DisplayPos.y,
+			draw_data->DisplaySize.x,
+			draw_data->DisplaySize.y,
+			draw_data->FramebufferScale.x,
+			draw_data->FramebufferScale.y};
 
-				for (auto& q : new_device->GetVkQueues())
-				{
-					FG::VulkanDeviceInfo::QueueInfo qi;
-					qi.handle	   = FGC::BitCast<FG::QueueVk_t>(q.handle);
-					qi.familyFlags = FGC::BitCast<FG::QueueFlagsVk_t>(q.familyFlags);
-					qi.familyIndex = q.familyIndex;
-					qi.priority	   = q.priority;
-					qi.debugName   = q.debugName;
+		const bool same_display = std::memcmp(display, m_display, sizeof(display)) == 0;
+		std::memcpy(m_display, display, sizeof(display));
 
-					vulkan_info.queues.push_back(qi);
-				}
-			}
-			m_shared.m_frame_graph = FG::IFrameGraph::CreateFrameGraph(vulkan_info);
+		if (!collect(draw_data))
+		{
+			m_valid = false;
+			m_previous.clear();
+			return false;
+		}
 
+		const bool valid = m_valid && same_display;
+		std::swap(m_previous, m_current);
+		m_valid = true;
+
+		if (!valid)
+		{
+			return false;
+		}
+
+		// both lists are sorted by hash, anything without a partner appeared or disappeared
+		size_t i = 0, j = 0;
+		while (i < m_previous.size() || j < m_current.size())
+		{
+			if (j == m_current.size() || (i < m_previous.size() && m_previous[i].m_hash < m_current[j].m_hash))
+			{
+				add_rect(INOUT damage, m_previous[i].m_rect);
+				++i;
+			}
+			else if (i == m_previous.size() || m_current[j].m_hash < m_previous[i].m_hash)
+			{
+				add_rect(INOUT damage, m_current[j].m_rect);
+				++j;
+			}
+			else
+			{
+				++i;
+				++j;
+			}
+		}
+		return true;
+	}
+
+	bool collect(const ImDrawData* draw_data)
+	{
+		m_current.clear();
+
+		const ImVec2 clip_off	= draw_data->DisplayPos;
+		const ImVec2 clip_scale = draw_data->FramebufferScale;
+
+		for (int i = 0; i < draw_data->CmdListsCount; ++i)
+		{
+			const ImDrawList& cmd_list = *draw_data->CmdLists[i];
+
+			for (int j = 0; j < cmd_list.CmdBuffer.Size; ++j)
+			{
+				const ImDrawCmd& cmd = cmd_list.CmdBuffer[j];
+
+				if (cmd.UserCallback)
+				{
+					if (cmd.UserCallback == ImDrawCallback_ResetRenderState)
+					{
+						continue;
+					}
+					return false;
+				}
+
+				if (cmd.ElemCount == 0)
+				{
+					continue;
+				}
+
+				// Indices are rebased to the first one, so a command hashes the same when earlier geometry in the list changes size.
+				const ImDrawIdx* indices   = cmd_list.IdxBuffer.Data + cmd.IdxOffset;
+				const uint32_t	 first	   = indices[0];
+				uint32_t		 min_index = first;
+				uint32_t		 max_index = first;
+
+				m_rebased.resize(cmd.ElemCount);
+				for (uint32_t k = 0; k < cmd.ElemCount; ++k)
+				{
+					const uint32_t index = indices[k];
+					min_index			 = std::min(min_index, index);
+					max_index			 = std::max(max_index, index);
+					m_rebased[k]		 = index - first;
+				}
+
+				const ImDrawVert* vertices = cmd_list.VtxBuffer.Data + cmd.VtxOffset + min_index;
+				const size_t	  count	   = size_t(max_index - min_index) + 1;
+
+				ImVec2 lo = vertices[0].pos;
+				ImVec2 hi = vertices[0].pos;
+				for (size_t k = 1; k < count; ++k)
+				{
+					lo.x = std::min(lo.x, vertices[k].pos.x);
+					lo.y = std::min(lo.y, vertices[k].pos.y);
+					hi.x = std::max(hi.x, vertices[k].pos.x);
+					hi.y = std::max(hi.y, vertices[k].pos.y);
+				}
+
+				lo.x = std::max(lo.x, cmd.ClipRect.x);
+				lo.y = std::max(lo.y, cmd.ClipRect.y);
+				hi.x = std::min(hi.x, cmd.ClipRect.z);
+				hi.y = std::min(hi.y, cmd.ClipRect.w);
+
+				// the same commands in another order overlap differently, so the order is part of the hash
+				const int order[2] = {i, j};
+
+				entry e;
+				e.m_hash		= draw_data_hasher::hash_memory(order, sizeof(order), uint64_t(uintptr_t(cmd.TextureId)));
+				e.m_hash		= draw_data_hasher::hash_memory(&cmd.ClipRect, sizeof(cmd.ClipRect), e.m_hash);
+				e.m_hash		= draw_data_hasher::hash_memory(m_rebased.data(), m_rebased.size() * sizeof(uint32_t), e.m_hash);
+				e.m_hash		= draw_data_hasher::hash_memory(vertices, count * sizeof(ImDrawVert), e.m_hash);
+				e.m_rect.left	= int(std::floor((lo.x - clip_off.x) * clip_scale.x)) - 1; // one pixel margin for antialiased fringes
+				e.m_rect.top	= int(std::floor((lo.y - clip_off.y) * clip_scale.y)) - 1;
+				e.m_rect.right	= int(std::ceil((hi.x - clip_off.x) * clip_scale.x)) + 1;
+				e.m_rect.bottom = int(std::ceil((hi.y - clip_off.y) * clip_scale.y)) + 1;
+
+				m_current.push_back(e);
+			}
+		}
+
+		std::sort(m_current.begin(), m_current.end(), [](const entry& a, const entry& b) { return a.m_hash < b.m_hash; });
+		return true;
+	}
+};
+
+// Per-user directory of the on-disk caches: %LOCALAPPDATA%\imgui_app_fw on Windows, ~/Library/Caches/imgui_app_fw on macOS,
+// $XDG_CACHE_HOME/imgui_app_fw or ~/.cache/imgui_app_fw elsewhere. Empty when the environment names no such directory.
+static std::filesystem::path default_cache_directory()
+{
+	const auto from_env = [](const char* name) {
+		const char* value = std::getenv(name);
+		return value && *value ? std::filesystem::path{value} : std::filesystem::path{};
+	};
+
+#if defined(_WIN32)
+	std::filesystem::path base = from_env("LOCALAPPDATA");
+#elif defined(__APPLE__)
+	std::filesystem::path base = from_env("HOME");
+	if (!base.empty())
+	{
+		base /= "Library/Caches";
+	}
+#else
+	std::filesystem::path base = from_env("XDG_CACHE_HOME");
+	if (base.empty() && !(base = from_env("HOME")).empty())
+	{
+		base /= ".cache";
+	}
+#endif
+	return base.empty() ? base : base / "imgui_app_fw";
+}
+
+// A cache file in directory, empty (caching disabled) when the directory is.
+static std::filesystem::path cache_file(const std::filesystem::path& directory, const char* name)
+{
+	return directory.empty() ? std::filesystem::path{} : directory / name;
+}
+
+// Turns the coverage the atlas builder rasterized into signed distance, 0.5 on glyph edges, so an atlas built once at the base
+// size stays sharp at any scale. Glyph quads grow by k_spread pixels to hold the falloff, the atlas padding keeps those margins
+// apart. Glyphs are converted in parallel and the result is cached on disk, keyed by a hash of the coverage atlas.
+struct sdf_font_builder
+{
+	static constexpr int	  k_spread	= 4;
+	static constexpr uint32_t k_magic	= 0x46445346; // 'FSDF'
+	static constexpr uint32_t k_version = 1;
+
+	struct file_header
+	{
+		uint32_t magic;
+		uint32_t version;
+		uint32_t width;
+		uint32_t height;
+		uint64_t source_hash;
+		uint64_t data_hash;
+	};
+
+	struct glyph_rect
+	{
+		int x0, y0, x1, y1;
+
+		bool operator<(const glyph_rect& rhs) const
+		{
+			return std::tie(y0, x0, y1, x1) < std::tie(rhs.y0, rhs.x0, rhs.y1, rhs.x1);
+		}
+		bool operator==(const glyph_rect& rhs) const
+		{
+			return x0 == rhs.x0 && y0 == rhs.y0 && x1 == rhs.x1 && y1 == rhs.y1;
+		}
+	};
+
+	struct sample_offset
+	{
+		int	  dx, dy;
+		float distance;
+	};
+
+	std::filesystem::path m_path	  = cache_file(default_cache_directory(), "sdf_cache"); // empty disables the cache
+	const uint8_t*		  m_converted = nullptr; // atlas pixels that already hold distance
+
+	// atlas settings replaced by prepare(), put back by restore()
+	int						m_saved_padding = -1;
+	ImFontAtlasFlags		m_saved_flags	= 0;
+	std::vector<ImVec2>		m_saved_oversample;
+	std::vector<glyph_rect> m_rects;
+	std::vector<uint8_t>	m_coverage;
+
+	// Before the atlas is built: room for the margins, no baked line textures (they hold coverage, not distance) and no
+	// oversampling, which the distance field makes unnecessary.
+	void prepare(ImFontAtlas* atlas)
+	{
+		if (m_saved_padding < 0)
+		{
+			m_saved_padding = atlas->TexGlyphPadding;
+			m_saved_flags	= atlas->Flags;
+		}
+		atlas->TexGlyphPadding = 2 * k_spread + 1;
+		atlas->Flags |= ImFontAtlasFlags_NoBakedLines;
+
+		m_saved_oversample.resize(size_t(atlas->ConfigData.Size));
+		for (int i = 0; i < atlas->ConfigData.Size; ++i)
+		{
+			ImFontConfig& config = atlas->ConfigData[i];
+			if (config.OversampleH != 1 || config.OversampleV != 1)
+			{
+				m_saved_oversample[size_t(i)] = ImVec2(float(config.OversampleH), float(config.OversampleV));
+			}
+			config.OversampleH = 1;
+			config.OversampleV = 1;
+		}
+		m_converted = nullptr;
+	}
+
+	void restore(ImFontAtlas* atlas)
+	{
+		if (m_saved_padding >= 0)
+		{
+			atlas->TexGlyphPadding = m_saved_padding;
+			atlas->Flags		   = m_saved_flags;
+			m_saved_padding		   = -1;
+		}
+		for (int i = 0; i < atlas->ConfigData.Size && size_t(i) < m_saved_oversample.size(); ++i)
+		{
+			if (m_saved_oversample[size_t(i)].x > 0.0f)
+			{
+				atlas->ConfigData[i].OversampleH = int(m_saved_oversample[size_t(i)].x);
+				atlas->ConfigData[i].OversampleV = int(m_saved_oversample[size_t(i)].y);
+			}
+		}
+		m_saved_oversample.clear();
+		m_converted = nullptr;
+	}
+
+	// Offsets within k_spread, nearest first, so the search stops at the first texel on the other side of the edge.
+	static const std::vector<sample_offset>& sample_offsets()
+	{
+		static const std::vector<sample_offset> offsets = []() {
+			std::vector<sample_offset> result;
+			for (int dy = -k_spread; dy <= k_spread; ++dy)
+			{
+				for (int dx = -k_spread; dx <= k_spread; ++dx)
+				{
+					const float distance = std::sqrt(float(dx * dx + dy * dy));
+					if ((dx != 0 || dy != 0) && distance <= float(k_spread))
+					{
+						result.push_back({dx, dy, distance});
+					}
+				}
+			}
+			std::sort(result.begin(), result.end(), [](const sample_offset& lhs, const sample_offset& rhs) { return lhs.distance < rhs.distance; });
+			return result;
+		}();
+		return offsets;
+	}
+
+	// Reads coverage in a width x height area, texels outside it count as empty, and writes distance into the last channel of
+	// dst. Other channels are set to 255 so RGBA atlases stay white.
+	static void coverage_to_distance(const uint8_t* src, size_t src_pitch, int width, int height, uint8_t* dst, size_t dst_pitch, size_t dst_bytes_per_pixel)
+	{
+		const std::vector<sample_offset>& offsets = sample_offsets();
+
+		for (int y = 0; y < height; ++y)
+		{
+			for (int x = 0; x < width; ++x)
+			{
+				const bool inside	= src[size_t(y) * src_pitch + size_t(x)] >= 128;
+				float	   distance = float(k_spread);
+
+				for (const sample_offset& offset : offsets)
+				{
+					const int  sx			= x + offset.dx;
+					const int  sy			= y + offset.dy;
+					const bool other_inside = sx >= 0 && sy >= 0 && sx < width && sy < height && src[size_t(sy) * src_pitch + size_t(sx)] >= 128;
+					if (other_inside != inside)
+					{
+						distance = offset.distance;
+						break;
+					}
+				}
+
+				// the edge lies halfway between the two texels
+				const float signed_distance = inside ? distance - 0.5f : 0.5f - distance;
+				const float value			= std::clamp(0.5f + signed_distance / (2.0f * k_spread), 0.0f, 1.0f);
+
+				uint8_t* texel = dst + size_t(y) * dst_pitch + size_t(x) * dst_bytes_per_pixel;
+				std::memset(texel, 255, dst_bytes_per_pixel - 1);
+				texel[dst_bytes_per_pixel - 1] = uint8_t(value * 255.0f + 0.5f);
+			}
+		}
+	}
+
+	// After the atlas is built, rewrites its alpha8 pixels in place and grows the glyph quads. Does nothing for pixels it
+	// already converted.
+	void convert(ImFontAtlas* atlas, uint8_t* pixels, worker_pool* workers)
+	{
+		if (pixels == m_converted)
+		{
+			return;
+		}
+		m_converted = pixels;
+
+		const int	   width	   = atlas->TexWidth;
+		const int	   height	   = atlas->TexHeight;
+		const size_t   size		   = size_t(width) * size_t(height);
+		const uint64_t source_hash = draw_data_hasher::hash_memory(pixels, size, k_spread);
+
+		// merged fonts can point several glyphs at one rect
+		m_rects.clear();
+		for (ImFont* font : atlas->Fonts)
+		{
+			for (ImFontGlyph& glyph : font->Glyphs)
+			{
+				if (!glyph.Visible)
+				{
+					continue;
+				}
+				glyph_rect rect;
+				rect.x0 = std::max(int(glyph.U0 * width + 0.5f) - k_spread, 0);
+				rect.y0 = std::max(int(glyph.V0 * height + 0.5f) - k_spread, 0);
+				rect.x1 = std::min(int(glyph.U1 * width + 0.5f) + k_spread, width);
+				rect.y1 = std::min(int(glyph.V1 * height + 0.5f) + k_spread, height);
+				m_rects.push_back(rect);
+			}
+		}
+		std::sort(m_rects.begin(), m_rects.end());
+		m_rects.erase(std::unique(m_rects.begin(), m_rects.end()), m_rects.end());
+
+		if (!read_cache(width, height, source_hash, pixels))
+		{
+			// rects don't overlap, so workers write disjoint texels while reading from an untouched copy
+			m_coverage.assign(pixels, pixels + size);
+
+			const worker_pool::job_t job = [&](size_t i) {
+				const glyph_rect& rect	 = m_rects[i];
+				const size_t	  offset = size_t(rect.y0) * size_t(width) + size_t(rect.x0);
+				coverage_to_distance(m_coverage.data() + offset, size_t(width), rect.x1 - rect.x0, rect.y1 - rect.y0, pixels + offset, size_t(width), 1);
+			};
+
+			if (workers && workers->is_running())
+			{
+				workers->parallel_for(m_rects.size(), job);
+			}
+			else
+			{
+				worker_pool pool;
+				pool.start(worker_pool::default_thread_count());
+				pool.parallel_for(m_rects.size(), job);
+			}
+
+			write_cache(width, height, source_hash, pixels);
+			m_coverage.clear();
+			m_coverage.shrink_to_fit();
+		}
+
+		for (ImFont* font : atlas->Fonts)
+		{
+			for (ImFontGlyph& glyph : font->Glyphs)
+			{
+				if (glyph.Visible)
+				{
+					grow_glyph(glyph, width, height);
+				}
+			}
+		}
+	}
+
+	// Grows the quad by the spread on every side the atlas has room for, in glyph units.
+	static void grow_glyph(ImFontGlyph& glyph, int width, int height)
+	{
+		const float texels_x = (glyph.U1 - glyph.U0) * width;
+		const float texels_y = (glyph.V1 - glyph.V0) * height;
+		const float scale_x	 = texels_x > 0.0f ? (glyph.X1 - glyph.X0) / texels_x : 1.0f;
+		const float scale_y	 = texels_y > 0.0f ? (glyph.Y1 - glyph.Y0) / texels_y : 1.0f;
+
+		const float left   = std::min(float(k_spread), glyph.U0 * width);
+		const float top	   = std::min(float(k_spread), glyph.V0 * height);
+		const float right  = std::min(float(k_spread), (1.0f - glyph.U1) * width);
+		const float bottom = std::min(float(k_spread), (1.0f - glyph.V1) * height);
+
+		glyph.X0 -= left * scale_x;
+		glyph.Y0 -= top * scale_y;
+		glyph.X1 += right * scale_x;
+		glyph.Y1 += bottom * scale_y;
+		glyph.U0 -= left / width;
+		glyph.V0 -= top / height;
+		glyph.U1 += right / width;
+		glyph.V1 += bottom / height;
+	}
+
+	bool read_cache(int width, int height, uint64_t source_hash, uint8_t* pixels) const
+	{
+		if (m_path.empty())
+		{
+			return false;
+		}
+
+		std::ifstream file{m_path, std::ios::binary};
+		if (!file)
+		{
+			return false;
+		}
+
+		file_header hdr{};
+		if (!file.read(reinterpret_cast<char*>(&hdr), sizeof(hdr)) || hdr.magic != k_magic || hdr.version != k_version || hdr.width != uint32_t(width) ||
+			hdr.height != uint32_t(height) || hdr.source_hash != source_hash)
+		{
+			// another font set, it will be overwritten
+			return false;
+		}
+
+		std::vector<uint8_t> data(size_t(width) * size_t(height));
+		if (!file.read(reinterpret_cast<char*>(data.data()), data.size()) || draw_data_hasher::hash_memory(data.data(), data.size(), 0) != hdr.data_hash)
+		{
+			return false;
+		}
+		std::memcpy(pixels, data.data(), data.size());
+		return true;
+	}
+
+	bool write_cache(int width, int height, uint64_t source_hash, const uint8_t* pixels) const
+	{
+		if (m_path.empty())
+		{
+			return false;
+		}
+
+		const size_t size = size_t(width) * size_t(height);
+
+		file_header hdr{};
+		hdr.magic		= k_magic;
+		hdr.version		= k_version;
+		hdr.width		= uint32_t(width);
+		hdr.height		= uint32_t(height);
+		hdr.source_hash = source_hash;
+		hdr.data_hash	= draw_data_hasher::hash_memory(pixels, size, 0);
+
+		// written next to the cache and renamed over it, so an interrupted write never leaves a torn file
+		std::error_code ec;
+		std::filesystem::create_directories(m_path.parent_path(), ec);
+
+		std::filesystem::path tmp_path = m_path;
+		tmp_path += ".tmp";
+		{
+			std::ofstream file{tmp_path, std::ios::binary | std::ios::trunc};
+			CHECK_ERR(file);
+			file.write(reinterpret_cast<const char*>(&hdr), sizeof(hdr));
+			file.write(reinterpret_cast<const char*>(pixels), size);
+			CHECK_ERR(file.good());
+		}
+
+		std::filesystem::rename(tmp_path, m_path, ec);
+		if (ec)
+		{
+			std::filesystem::remove(tmp_path, ec);
+			return false;
+		}
+		return true;
+	}
+};
+
+// Persists a built atlas (alpha8 pixels, custom rect positions, font metrics and glyphs) so later runs skip rasterization.
+// The key covers the font data and every atlas and config field that affects the build, plus the ImGui version.
+struct font_atlas_cache
+{
+	static constexpr uint32_t k_magic	= 0x41465746; // 'FWFA'
+	static constexpr uint32_t k_version = 1;
+
+	struct file_header
+	{
+		uint32_t magic;
+		uint32_t version;
+		uint64_t key;
+		int32_t	 tex_width;
+		int32_t	 tex_height;
+		int32_t	 font_count;
+		int32_t	 rect_count;
+		uint64_t data_size;
+		uint64_t data_hash;
+	};
+
+	struct font_header
+	{
+		float	ascent;
+		float	descent;
+		int32_t glyph_count;
+	};
+
+	std::filesystem::path m_path = cache_file(default_cache_directory(), "font_cache"); // empty disables the cache
+
+	static int font_index(const ImFontAtlas* atlas, const ImFont* font)
+	{
+		for (int i = 0; i < atlas->Fonts.Size; ++i)
+		{
+			if (atlas->Fonts[i] == font)
+			{
+				return i;
+			}
+		}
+		return -1;
+	}
+
+	static uint64_t key(const ImFontAtlas* atlas)
+	{
+		uint64_t h	 = draw_data_hasher::hash_memory(IMGUI_VERSION, std::strlen(IMGUI_VERSION), sizeof(ImFontGlyph));
+		auto	 add = [&h](const void* data, size_t size) { h = draw_data_hasher::hash_memory(data, size, h); };
+
+		const int atlas_fields[] = {int(atlas->Flags), atlas->TexDesiredWidth, atlas->TexGlyphPadding, atlas->Fonts.Size, atlas->ConfigData.Size};
+		add(atlas_fields, sizeof(atlas_fields));
+
+		for (const ImFontConfig& config : atlas->ConfigData)
+		{
+			add(config.FontData, size_t(config.FontDataSize));
+
+			const float config_fields[] = {
+				config.SizePixels,
+				float(config.FontNo),
+				float(config.OversampleH),
+				float(config.OversampleV),
+				float(config.PixelSnapH),
+				config.GlyphExtraSpacing.x,
+				config.GlyphExtraSpacing.y,
+				config.GlyphOffset.x,
+				config.GlyphOffset.y,
+				config.GlyphMinAdvanceX,
+				config.GlyphMaxAdvanceX,
+				float(config.MergeMode),
+				float(config.FontBuilderFlags),
+				config.RasterizerMultiply,
+				float(config.EllipsisChar),
+				float(font_index(atlas, config.DstFont))};
+			add(config_fields, sizeof(config_fields));
+
+			for (const ImWchar* range = config.GlyphRanges; range && range[0]; range += 2)
+			{
+				add(range, 2 * sizeof(ImWchar));
+			}
+		}
+
+		for (const ImFontAtlasCustomRect& rect : atlas->CustomRects)
+		{
+			const float rect_fields[] = {
+				float(rect.Width), float(rect.Height), float(rect.GlyphID), rect.GlyphAdvanceX, rect.GlyphOffset.x, rect.GlyphOffset.y, float(font_index(atlas, rect.Font))};
+			add(rect_fields, sizeof(rect_fields));
+		}
+		return h;
+	}
+
+	// Fills the atlas the way ImFontAtlas::Build() would have, returns false if the file doesn't match the key.
+	bool load(ImFontAtlas* atlas, uint64_t key) const
+	{
+		if (m_path.empty())
+		{
+			return false;
+		}
+
+		std::ifstream file{m_path, std::ios::binary};
+		if (!file)
+		{
+			return false;
+		}
+
+		file_header hdr{};
+		if (!file.read(reinterpret_cast<char*>(&hdr), sizeof(hdr)) || hdr.magic != k_magic || hdr.version != k_version || hdr.key != key ||
+			hdr.font_count != atlas->Fonts.Size || hdr.rect_count != atlas->CustomRects.Size)
+		{
+			// another font set, it will be overwritten
+			return false;
+		}
+
+		std::vector<uint8_t> data(size_t(hdr.data_size));
+		if (!file.read(reinterpret_cast<char*>(data.data()), data.size()) || draw_data_hasher::hash_memory(data.data(), data.size(), 0) != hdr.data_hash)
+		{
+			return false;
+		}
+
+		const uint8_t* cursor = data.data();
+		const uint8_t* end	  = data.data() + data.size();
+		auto		   read	  = [&cursor, end](void* dst, size_t size) -> bool {
+			if (size_t(end - cursor) < size)
+			{
+				return false;
+			}
+			std::memcpy(dst, cursor, size);
+			cursor += size;
+			return true;
+		};
+
+		ImVec2 uv_scale, uv_white_pixel;
+		ImVec4 uv_lines[IM_ARRAYSIZE(atlas->TexUvLines)];
+		CHECK_ERR(read(&uv_scale, sizeof(uv_scale)) && read(&uv_white_pixel, sizeof(uv_white_pixel)) && read(uv_lines, sizeof(uv_lines)));
+
+		std::vector<ImVec2> rect_positions(size_t(hdr.rect_count));
+		CHECK_ERR(read(rect_positions.data(), rect_positions.size() * sizeof(ImVec2)));
+
+		std::vector<font_header> fonts(size_t(hdr.font_count));
+		std::vector<ImVector<ImFontGlyph>> glyphs(size_t(hdr.font_count));
+		for (size_t i = 0; i < fonts.size(); ++i)
+		{
+			CHECK_ERR(read(&fonts[i], sizeof(font_header)) && fonts[i].glyph_count >= 0);
+			glyphs[i].resize(fonts[i].glyph_count);
+			CHECK_ERR(read(glyphs[i].Data, size_t(fonts[i].glyph_count) * sizeof(ImFontGlyph)));
+		}
+
+		const size_t pixel_count = size_t(hdr.tex_width) * size_t(hdr.tex_height);
+		CHECK_ERR(size_t(end - cursor) == pixel_count);
+
+		atlas->ClearTexData();
+		atlas->TexWidth		   = hdr.tex_width;
+		atlas->TexHeight	   = hdr.tex_height;
+		atlas->TexUvScale	   = uv_scale;
+		atlas->TexUvWhitePixel = uv_white_pixel;
+		std::memcpy(atlas->TexUvLines, uv_lines, sizeof(uv_lines));
+
+		for (int i = 0; i < atlas->CustomRects.Size; ++i)
+		{
+			atlas->CustomRects[i].X = (unsigned short)rect_positions[size_t(i)].x;
+			atlas->CustomRects[i].Y = (unsigned short)rect_positions[size_t(i)].y;
+		}
+
+		for (ImFontConfig& config : atlas->ConfigData)
+		{
+			const font_header& font = fonts[size_t(font_index(atlas, config.DstFont))];
+			ImFontAtlasBuildSetupFont(atlas, config.DstFont, &config, font.ascent, font.descent);
+		}
+		for (int i = 0; i < atlas->Fonts.Size; ++i)
+		{
+			atlas->Fonts[i]->Glyphs.swap(glyphs[size_t(i)]);
+			atlas->Fonts[i]->BuildLookupTable();
+		}
+
+		atlas->TexPixelsAlpha8 = (unsigned char*)IM_ALLOC(pixel_count);
+		std::memcpy(atlas->TexPixelsAlpha8, cursor, pixel_count);
+		atlas->TexReady = true;
+		return true;
+	}
+
+	bool save(const ImFontAtlas* atlas, uint64_t key) const
+	{
+		if (m_path.empty())
+		{
+			return false;
+		}
+		CHECK_ERR(atlas->TexPixelsAlpha8);
+
+		std::vector<uint8_t> data;
+		auto write = [&data](const void* src, size_t size) {
+			const uint8_t* bytes = static_cast<const uint8_t*>(src);
+			data.insert(data.end(), bytes, bytes + size);
+		};
+
+		write(&atlas->TexUvScale, sizeof(atlas->TexUvScale));
+		write(&atlas->TexUvWhitePixel, sizeof(atlas->TexUvWhitePixel));
+		write(atlas->TexUvLines, sizeof(atlas->TexUvLines));
+
+		for (const ImFontAtlasCustomRect& rect : atlas->CustomRects)
+		{
+			const ImVec2 position{float(rect.X), float(rect.Y)};
+			write(&position, sizeof(position));
+		}
+
+		for (const ImFont* font : atlas->Fonts)
+		{
+			const font_header header{font->Ascent, font->Descent, font->Glyphs.Size};
+			write(&header, sizeof(header));
+			write(font->Glyphs.Data, size_t(font->Glyphs.Size) * sizeof(ImFontGlyph));
+		}
+
+		write(atlas->TexPixelsAlpha8, size_t(atlas->TexWidth) * size_t(atlas->TexHeight));
+
+		file_header hdr{};
+		hdr.magic	   = k_magic;
+		hdr.version	   = k_version;
+		hdr.key		   = key;
+		hdr.tex_width  = atlas->TexWidth;
+		hdr.tex_height = atlas->TexHeight;
+		hdr.font_count = atlas->Fonts.Size;
+		hdr.rect_count = atlas->CustomRects.Size;
+		hdr.data_size  = data.size();
+		hdr.data_hash  = draw_data_hasher::hash_memory(data.data(), data.size(), 0);
+
+		// same write-then-rename as the SDF cache
+		std::error_code ec;
+		std::filesystem::create_directories(m_path.parent_path(), ec);
+
+		std::filesystem::path tmp_path = m_path;
+		tmp_path += ".tmp";
+		{
+			std::ofstream file{tmp_path, std::ios::binary | std::ios::trunc};
+			CHECK_ERR(file);
+			file.write(reinterpret_cast<const char*>(&hdr), sizeof(hdr));
+			file.write(reinterpret_cast<const char*>(data.data()), data.size());
+			CHECK_ERR(file.good());
+		}
+
+		std::filesystem::rename(tmp_path, m_path, ec);
+		if (ec)
+		{
+			std::filesystem::remove(tmp_path, ec);
+			return false;
+		}
+		return true;
+	}
+};
+
+// Rasterizes glyphs the baked atlas is missing the first time they are requested, into pages reserved as atlas custom rects,
+// so fonts can be loaded with small glyph ranges. Each page is split into square cells of one size class, a full class
+// evicts its least recently drawn glyph once it has gone unused for k_cold_frames. An evicted glyph is removed from its font
+// and draws as the fallback glyph until it is requested or typed again. Lives on the ImGui thread.
+struct glyph_cache
+{
+	static constexpr int	  k_page_size			= 512;
+	static constexpr int	  k_min_cell_size		= 16;
+	static constexpr int	  k_cell_classes		= 4; // 16, 32, 64 and 128 pixel cells
+	static constexpr uint32_t k_max_pages			= 64;
+	static constexpr uint64_t k_cold_frames			= 120;
+	static constexpr uint64_t k_usage_scan_interval = 8; // frames between scans of the draw data for cached glyph UVs
+
+	struct slot
+	{
+		ImFont*	 m_font		 = nullptr; // null while the cell is free
+		ImWchar	 m_codepoint = 0;
+		uint64_t m_last_used = 0;
+	};
+
+	struct page
+	{
+		int				  m_rect_id	   = -1;
+		int				  m_x		   = 0; // atlas position, read back after every atlas build
+		int				  m_y		   = 0;
+		int				  m_cell_class = -1; // assigned when the first glyph lands on the page
+		std::vector<slot> m_slots;
+		int				  m_dirty_x0 = k_page_size; // page area written since the last upload
+		int				  m_dirty_y0 = k_page_size;
+		int				  m_dirty_x1 = 0;
+		int				  m_dirty_y1 = 0;
+	};
+
+	struct font_source
+	{
+		const ImFontConfig* m_config;
+		stbtt_fontinfo		m_info;
+		float				m_scale;
+	};
+
+	struct glyph_key
+	{
+		ImFont* m_font;
+		ImWchar m_codepoint;
+	};
+
+	uint32_t				 m_page_count = 0;
+	std::vector<int>		 m_rect_ids; // custom rects can't be removed from an atlas, shrinking keeps them for later
+	std::vector<page>		 m_pages;
+	std::vector<font_source> m_sources;
+	std::vector<ImWchar>	 m_requests;
+	std::vector<glyph_key>	 m_missing; // requested glyphs no font had, collected before any is added
+	std::vector<ImFont*>	 m_touched_fonts;
+	std::vector<uint8_t>	 m_upload; // dirty page area packed for UpdateImage
+	uint8_t*				 m_pixels		   = nullptr;
+	size_t					 m_bytes_per_pixel = 1;
+	int						 m_tex_width	   = 0;
+	int						 m_tex_height	   = 0;
+	uint64_t				 m_frame		   = 0;
+	uint64_t				 m_glyphs		   = 0;
+	uint64_t				 m_rasterized	   = 0;
+	uint64_t				 m_evictions	   = 0;
+	uint64_t				 m_misses		   = 0; // requested glyphs that didn't fit, they draw as the fallback glyph
+	uint64_t				 m_upload_bytes	   = 0;
+	int						 m_sdf_spread	   = 0; // margin around glyphs holding the distance falloff in SDF font mode
+
+	bool enabled() const
+	{
+		return m_page_count > 0;
+	}
+
+	// Adds custom rects up to m_page_count, only takes effect with the next atlas build.
+	void reserve(ImFontAtlas* atlas)
+	{
+		while (m_rect_ids.size() < m_page_count)
+		{
+			m_rect_ids.push_back(atlas->AddCustomRectRegular(k_page_size, k_page_size));
+		}
+		reset();
+	}
+
+	void reset()
+	{
+		m_pages.clear();
+		m_pages.resize(m_page_count);
+		for (uint32_t i = 0; i < m_page_count; ++i)
+		{
+			m_pages[i].m_rect_id = m_rect_ids[i];
+		}
+		m_sources.clear();
+		m_pixels = nullptr;
+		m_glyphs = 0;
+	}
+
+	// Called once the atlas is built with the pixels that get uploaded. A rebuilt atlas dropped every cached glyph, a new pixel
+	// buffer for the same atlas (the upload format changed) lacks them, so they are removed from their fonts.
+	void sync(ImFontAtlas* atlas, uint8_t* pixels, size_t bytes_per_pixel)
+	{
+		const bool same_pixels = pixels == m_pixels && m_tex_width == atlas->TexWidth && m_tex_height == atlas->TexHeight;
+		const bool glyphs_kept = cached_glyphs_present();
+		if (same_pixels && glyphs_kept)
+		{
+			return;
+		}
+
+		if (glyphs_kept)
+		{
+			remove_glyphs();
+		}
+
+		reset();
+		m_pixels		  = pixels;
+		m_bytes_per_pixel = bytes_per_pixel;
+		m_tex_width		  = atlas->TexWidth;
+		m_tex_height	  = atlas->TexHeight;
+
+		for (page& pg : m_pages)
+		{
+			const ImFontAtlasCustomRect* rect = atlas->GetCustomRectByIndex(pg.m_rect_id);
+			pg.m_x							  = rect->X;
+			pg.m_y							  = rect->Y;
+		}
+
+		collect_sources(atlas, OUT m_sources);
+	}
+
+	static void collect_sources(const ImFontAtlas* atlas, OUT std::vector<font_source>& sources)
+	{
+		sources.clear();
+		for (const ImFontConfig& config : atlas->ConfigData)
+		{
+			font_source	   source{&config};
+			const uint8_t* data = reinterpret_cast<const uint8_t*>(config.FontData);
+			if (!stbtt_InitFont(&source.m_info, data, stbtt_GetFontOffsetForIndex(data, config.FontNo)))
+			{
+				continue;
+			}
+			source.m_scale = config.SizePixels > 0.0f ? stbtt_ScaleForPixelHeight(&source.m_info, config.SizePixels)
+													  : stbtt_ScaleForMappingEmToPixels(&source.m_info, -config.SizePixels);
+			sources.push_back(source);
+		}
+	}
+
+	bool cached_glyphs_present() const
+	{
+		for (const page& pg : m_pages)
+		{
+			for (const slot& s : pg.m_slots)
+			{
+				if (s.m_font)
+				{
+					return s.m_font->FindGlyphNoFallback(s.m_codepoint) != nullptr;
+				}
+			}
+		}
+		return true;
+	}
+
+	void request(const char* text, const char* text_end = nullptr)
+	{
+		if (!text_end)
+		{
+			text_end = text + std::strlen(text);
+		}
+
+		while (text < text_end)
+		{
+			unsigned int c = 0;
+			text += ImTextCharFromUtf8(&c, text, text_end);
+			if (c == 0)
+			{
+				break;
+			}
+			if (c <= IM_UNICODE_CODEPOINT_MAX)
+			{
+				m_requests.push_back(ImWchar(c));
+			}
+		}
+	}
+
+	// Before ImGui::NewFrame(): rasterizes the requested and freshly typed characters that some font can draw but lacks, which
+	// includes evicted glyphs. The cached ones among them are marked as used first, so a request never evicts another glyph of
+	// the same batch, and a glyph requested within k_cold_frames isn't evicted at all.
+	void update(ImFontAtlas* atlas, const ImGuiIO& io)
+	{
+		++m_frame;
+
+		m_requests.insert(m_requests.end(), io.InputQueueCharacters.begin(), io.InputQueueCharacters.end());
+		if (m_requests.empty() || !m_pixels)
+		{
+			m_requests.clear();
+			return;
+		}
+
+		std::sort(m_requests.begin(), m_requests.end());
+		m_requests.erase(std::unique(m_requests.begin(), m_requests.end()), m_requests.end());
+
+		// every lookup happens before a glyph is added or evicted, those leave the lookup tables stale until rebuild_touched_fonts()
+		m_missing.clear();
+		for (ImWchar c : m_requests)
+		{
+			for (ImFont* font : atlas->Fonts)
+			{
+				if (const ImFontGlyph* glyph = font->FindGlyphNoFallback(c))
+				{
+					mark_used(ImVec2(glyph->U0, glyph->V0));
+				}
+				else
+				{
+					m_missing.push_back({font, c});
+				}
+			}
+		}
+		m_requests.clear();
+
+		for (const glyph_key& missing : m_missing)
+		{
+			add_glyph(missing.m_font, missing.m_codepoint);
+		}
+
+		rebuild_touched_fonts();
+	}
+
+	void add_glyph(ImFont* font, ImWchar c)
+	{
+		for (font_source& source : m_sources)
+		{
+			if (source.m_config->DstFont != font)
+			{
+				continue;
+			}
+
+			const int glyph_index = stbtt_FindGlyphIndex(&source.m_info, c);
+			if (glyph_index == 0)
+			{
+				continue;
+			}
+
+			int x0, y0, x1, y1;
+			stbtt_GetGlyphBitmapBox(&source.m_info, glyph_index, source.m_scale, source.m_scale, &x0, &y0, &x1, &y1);
+
+			const int margin	 = m_sdf_spread;
+			const int width		 = x1 - x0 + 2 * margin;
+			const int height	 = y1 - y0 + 2 * margin;
+			const int cell_class = find_cell_class(std::max(width, height) + 1); // one pixel gap to the next cell
+
+			page* pg   = nullptr;
+			int	  cell = -1;
+			if (cell_class < 0 || !allocate(cell_class, OUT pg, OUT cell))
+			{
+				++m_misses;
+				return;
+			}
+
+			const int cell_size = k_min_cell_size << cell_class;
+			const int columns	= k_page_size / cell_size;
+			const int cell_x	= (cell % columns) * cell_size;
+			const int cell_y	= (cell / columns) * cell_size;
+
+			rasterize(source, glyph_index, pg->m_x + cell_x, pg->m_y + cell_y, cell_size, width, height, margin);
+
+			int advance, left_bearing;
+			stbtt_GetGlyphHMetrics(&source.m_info, glyph_index, &advance, &left_bearing);
+
+			// same placement as ImFontAtlasBuildWithStbTruetype, without oversampling
+			const ImFontConfig& config = *source.m_config;
+			const float			off_x  = config.GlyphOffset.x;
+			const float			off_y  = config.GlyphOffset.y + IM_ROUND(font->Ascent);
+			const float			u0	   = float(pg->m_x + cell_x) / m_tex_width;
+			const float			v0	   = float(pg->m_y + cell_y) / m_tex_height;
+			touch_font(font);
+			font->AddGlyph(
+				&config, c, x0 - margin + off_x, y0 - margin + off_y, x1 + margin + off_x, y1 + margin + off_y, u0, v0, u0 + float(width) / m_tex_width,
+				v0 + float(height) / m_tex_height, advance * source.m_scale);
+
+			pg->m_slots[cell] = {font, c, m_frame};
+			pg->m_dirty_x0	  = std::min(pg->m_dirty_x0, cell_x);
+			pg->m_dirty_y0	  = std::min(pg->m_dirty_y0, cell_y);
+			pg->m_dirty_x1	  = std::max(pg->m_dirty_x1, cell_x + cell_size);
+			pg->m_dirty_y1	  = std::max(pg->m_dirty_y1, cell_y + cell_size);
+			++m_glyphs;
+			++m_rasterized;
+			return;
+		}
+	}
+
+	static int find_cell_class(int size)
+	{
+		for (int i = 0; i < k_cell_classes; ++i)
+		{
+			if (size <= (k_min_cell_size << i))
+			{
+				return i;
+			}
+		}
+		return -1;
+	}
+
+	// Picks a free cell of the class, a page nobody uses yet, or evicts the coldest glyph of the class.
+	bool allocate(int cell_class, OUT page*& result, OUT int& cell)
+	{
+		page* unassigned = nullptr;
+		page* coldest	 = nullptr;
+		int	  cold_cell	 = -1;
+
+		for (page& pg : m_pages)
+		{
+			if (pg.m_cell_class < 0)
+			{
+				unassigned = unassigned ? unassigned : &pg;
+				continue;
+			}
+			if (pg.m_cell_class != cell_class)
+			{
+				continue;
+			}
+			for (int i = 0; i < int(pg.m_slots.size()); ++i)
+			{
+				const slot& s = pg.m_slots[i];
+				if (!s.m_font)
+				{
+					result = &pg;
+					cell   = i;
+					return true;
+				}
+				if (!coldest || s.m_last_used < coldest->m_slots[cold_cell].m_last_used)
+				{
+					coldest	  = &pg;
+					cold_cell = i;
+				}
+			}
+		}
+
+		if (unassigned)
+		{
+			const int columns		 = k_page_size / (k_min_cell_size << cell_class);
+			unassigned->m_cell_class = cell_class;
+			unassigned->m_slots.assign(size_t(columns * columns), slot{});
+			result = unassigned;
+			cell   = 0;
+			return true;
+		}
+
+		if (coldest && coldest->m_slots[cold_cell].m_last_used + k_cold_frames < m_frame)
+		{
+			evict(coldest->m_slots[cold_cell]);
+			result = coldest;
+			cell   = cold_cell;
+			return true;
+		}
+		return false;
+	}
+
+	void evict(slot& s)
+	{
+		touch_font(s.m_font);
+
+		ImVector<ImFontGlyph>& glyphs = s.m_font->Glyphs;
+		for (ImFontGlyph& glyph : glyphs)
+		{
+			if (glyph.Codepoint == s.m_codepoint)
+			{
+				glyphs.erase(&glyph);
+				break;
+			}
+		}
+		s = slot{};
+		--m_glyphs;
+		++m_evictions;
+	}
+
+	void remove_glyphs()
+	{
+		for (page& pg : m_pages)
+		{
+			for (slot& s : pg.m_slots)
+			{
+				if (s.m_font)
+				{
+					evict(s);
+				}
+			}
+		}
+		rebuild_touched_fonts();
+	}
+
+	void rebuild_touched_fonts()
+	{
+		for (ImFont* font : m_touched_fonts)
+		{
+			font->BuildLookupTable();
+		}
+		m_touched_fonts.clear();
+	}
+
+	// Called before a font's glyphs change. BuildLookupTable() appends a tab glyph unless the last glyph already is one, so the
+	// tab it added is removed here and added back by rebuild_touched_fonts(), keeping Glyphs.Size at baked + cached glyphs.
+	void touch_font(ImFont* font)
+	{
+		if (std::find(m_touched_fonts.begin(), m_touched_fonts.end(), font) == m_touched_fonts.end())
+		{
+			if (!font->Glyphs.empty() && font->Glyphs.back().Codepoint == '\t')
+			{
+				font->Glyphs.pop_back();
+			}
+			m_touched_fonts.push_back(font);
+		}
+	}
+
+	// Renders coverage into scratch memory, then copies it into the cell, expanded to white texels for RGBA atlases or converted
+	// to distance when margin > 0. width and height include the margin.
+	void rasterize(const font_source& source, int glyph_index, int x, int y, int cell_size, int width, int height, int margin)
+	{
+		const size_t pitch = size_t(m_tex_width) * m_bytes_per_pixel;
+		uint8_t*	 cell  = m_pixels + size_t(y) * pitch + size_t(x) * m_bytes_per_pixel;
+
+		for (int row = 0; row < cell_size; ++row)
+		{
+			std::memset(cell + row * pitch, 0, size_t(cell_size) * m_bytes_per_pixel);
+		}
+
+		m_upload.assign(size_t(width) * size_t(height), 0);
+		uint8_t* coverage = m_upload.data() + size_t(margin) * size_t(width) + size_t(margin);
+		stbtt_MakeGlyphBitmap(&source.m_info, coverage, width - 2 * margin, height - 2 * margin, width, source.m_scale, source.m_scale, glyph_index);
+
+		const float multiply = source.m_config->RasterizerMultiply;
+		if (multiply != 1.0f)
+		{
+			for (uint8_t& value : m_upload)
+			{
+				value = uint8_t(std::min(255.0f, value * multiply));
+			}
+		}
+
+		if (margin > 0)
+		{
+			sdf_font_builder::coverage_to_distance(m_upload.data(), size_t(width), width, height, cell, pitch, m_bytes_per_pixel);
+			return;
+		}
+
+		for (int row = 0; row < height; ++row)
+		{
+			for (int col = 0; col < width; ++col)
+			{
+				uint8_t* texel = cell + row * pitch + col * m_bytes_per_pixel;
+				std::memset(texel, 255, m_bytes_per_pixel - 1);
+				texel[m_bytes_per_pixel - 1] = m_upload[size_t(row) * width + col];
+			}
+		}
+	}
+
+	// Every k_usage_scan_interval frames, marks the cached glyphs whose UVs appear in the draw data as used.
+	void scan_usage(const ImGuiPlatformIO& platform_io)
+	{
+		if (m_glyphs == 0 || m_frame % k_usage_scan_interval != 0)
+		{
+			return;
+		}
+
+		for (const ImGuiViewport* viewport : platform_io.Viewports)
+		{
+			const ImDrawData* draw_data = viewport->DrawData;
+			if (!draw_data)
+			{
+				continue;
+			}
+			for (int i = 0; i < draw_data->CmdListsCount; ++i)
+			{
+				const ImDrawList& list = *draw_data->CmdLists[i];
+				// glyphs are four vertex quads whose corners all map into their cell, so every fourth vertex finds each one
+				for (int v = 0; v < list.VtxBuffer.Size; v += 4)
+				{
+					mark_used(list.VtxBuffer[v].uv);
+				}
+			}
+		}
+	}
+
+	void mark_used(ImVec2 uv)
+	{
+		const int x = int(uv.x * m_tex_width);
+		const int y = int(uv.y * m_tex_height);
+
+		for (page& pg : m_pages)
+		{
+			if (pg.m_cell_class < 0 || x < pg.m_x || y < pg.m_y || x >= pg.m_x + k_page_size || y >= pg.m_y + k_page_size)
+			{
+				continue;
+			}
+			const int cell_size = k_min_cell_size << pg.m_cell_class;
+			const int columns	= k_page_size / cell_size;
+			pg.m_slots[size_t((y - pg.m_y) / cell_size * columns + (x - pg.m_x) / cell_size)].m_last_used = m_frame;
+			return;
+		}
+	}
+
+	bool has_dirty() const
+	{
+		for (const page& pg : m_pages)
+		{
+			if (pg.m_dirty_x1 > pg.m_dirty_x0)
+			{
+				return true;
+			}
+		}
+		return false;
+	}
+
+	void clear_dirty()
+	{
+		for (page& pg : m_pages)
+		{
+			pg.m_dirty_x0 = pg.m_dirty_y0 = k_page_size;
+			pg.m_dirty_x1 = pg.m_dirty_y1 = 0;
+		}
+	}
+
+	// Calls upload(x, y, width, height, data, size) once per page with the page's dirty area packed tightly.
+	template<typename T_UPLOAD>
+	void flush_dirty(T_UPLOAD&& upload)
+	{
+		const size_t pitch = size_t(m_tex_width) * m_bytes_per_pixel;
+
+		for (page& pg : m_pages)
+		{
+			if (pg.m_dirty_x1 <= pg.m_dirty_x0)
+			{
+				continue;
+			}
+
+			const int	 x		   = pg.m_x + pg.m_dirty_x0;
+			const int	 y		   = pg.m_y + pg.m_dirty_y0;
+			const int	 width	   = pg.m_dirty_x1 - pg.m_dirty_x0;
+			const int	 height	   = pg.m_dirty_y1 - pg.m_dirty_y0;
+			const size_t row_bytes = size_t(width) * m_bytes_per_pixel;
+
+			m_upload.resize(row_bytes * size_t(height));
+			for (int row = 0; row < height; ++row)
+			{
+				std::memcpy(m_upload.data() + size_t(row) * row_bytes, m_pixels + size_t(y + row) * pitch + size_t(x) * m_bytes_per_pixel, row_bytes);
+			}
+
+			upload(x, y, width, height, m_upload.data(), m_upload.size());
+			m_upload_bytes += m_upload.size();
+		}
+		clear_dirty();
+	}
+};
+
+// Renders the atlas again at an integer scale for viewports on high DPI monitors. The layout is the base atlas scaled up, so
+// every glyph UV stays valid and those viewports only bind another texture. Texels outside glyphs (custom rects, the white
+// pixel, baked lines) are copied nearest, glyphs are rasterized again at the scale into their scaled rects.
+struct dpi_atlas_builder
+{
+	struct glyph_job
+	{
+		const ImFont*					m_font;
+		const ImFontGlyph*				m_glyph;
+		const glyph_cache::font_source* m_source;
+	};
+
+	std::vector<glyph_cache::font_source> m_sources;
+	std::vector<glyph_job>				  m_jobs;
+
+	void build(const ImFontAtlas* atlas, const uint8_t* pixels, size_t bytes_per_pixel, int scale, worker_pool* workers, OUT std::vector<uint8_t>& result)
+	{
+		const int	 src_width = atlas->TexWidth;
+		const int	 width	   = src_width * scale;
+		const int	 height	   = atlas->TexHeight * scale;
+		const size_t pitch	   = size_t(width) * bytes_per_pixel;
+		result.resize(size_t(height) * pitch);
+
+		for (int y = 0; y < height; ++y)
+		{
+			const uint8_t* src = pixels + size_t(y / scale) * size_t(src_width) * bytes_per_pixel;
+			uint8_t*	   dst = result.data() + size_t(y) * pitch;
+			for (int x = 0; x < width; ++x)
+			{
+				std::memcpy(dst + size_t(x) * bytes_per_pixel, src + size_t(x / scale) * bytes_per_pixel, bytes_per_pixel);
+			}
+		}
+
+		glyph_cache::collect_sources(atlas, OUT m_sources);
+
+		m_jobs.clear();
+		for (const ImFont* font : atlas->Fonts)
+		{
+			for (const ImFontGlyph& glyph : font->Glyphs)
+			{
+				if (!glyph.Visible || is_custom_glyph(atlas, font, glyph.Codepoint))
+				{
+					continue;
+				}
+				if (const glyph_cache::font_source* source = find_source(font, ImWchar(glyph.Codepoint)))
+				{
+					m_jobs.push_back({font, &glyph, source});
+				}
+			}
+		}
+
+		// merged fonts can point several glyphs at one rect, only one of them may write it
+		const auto by_rect	 = [](const glyph_job& a, const glyph_job& b) { return std::tie(a.m_glyph->V0, a.m_glyph->U0) < std::tie(b.m_glyph->V0, b.m_glyph->U0); };
+		const auto same_rect = [](const glyph_job& a, const glyph_job& b) { return a.m_glyph->U0 == b.m_glyph->U0 && a.m_glyph->V0 == b.m_glyph->V0; };
+		std::sort(m_jobs.begin(), m_jobs.end(), by_rect);
+		m_jobs.erase(std::unique(m_jobs.begin(), m_jobs.end(), same_rect), m_jobs.end());
+
+		const worker_pool::job_t job = [&](size_t i) {
+			rasterize(m_jobs[i], atlas, scale, bytes_per_pixel, result.data(), pitch);
+		};
+
+		if (workers && workers->is_running())
+		{
+			workers->parallel_for(m_jobs.size(), job);
+		}
+		else
+		{
+			for (size_t i = 0; i < m_jobs.size(); ++i)
+			{
+				job(i);
+			}
+		}
+	}
+
+	static bool is_custom_glyph(const ImFontAtlas* atlas, const ImFont* font, unsigned int codepoint)
+	{
+		for (const ImFontAtlasCustomRect& rect : atlas->CustomRects)
+		{
+			if (rect.Font == font && rect.GlyphID == codepoint)
+			{
+				return true;
+			}
+		}
+		return false;
+	}
+
+	// The config ImGui took the glyph from: the first one whose ranges hold it, else the first that has it (glyph cache glyphs).
+	const glyph_cache::font_source* find_source(const ImFont* font, ImWchar c) const
+	{
+		static const ImWchar k_default_ranges[] = {0x0020, 0x00FF, 0}; // ImFontAtlas::GetGlyphRangesDefault()
+
+		const glyph_cache::font_source* fallback = nullptr;
+		for (const glyph_cache::font_source& source : m_sources)
+		{
+			if (source.m_config->DstFont != font || stbtt_FindGlyphIndex(&source.m_info, c) == 0)
+			{
+				continue;
+			}
+
+			for (const ImWchar* ranges = source.m_config->GlyphRanges ? source.m_config->GlyphRanges : k_default_ranges; ranges[0]; ranges += 2)
+			{
+				if (c >= ranges[0] && c <= ranges[1])
+				{
+					return &source;
+				}
+			}
+			fallback = fallback ? fallback : &source;
+		}
+		return fallback;
+	}
+
+	// The glyph's rect keeps its texel density relative to the quad (oversampling included), times the scale. The bitmap is
+	// shifted by the sub-texel part of the quad's top left corner, so that corner lands exactly on the rect's.
+	static void rasterize(const glyph_job& job, const ImFontAtlas* atlas, int scale, size_t bytes_per_pixel, uint8_t* pixels, size_t pitch)
+	{
+		const ImFontGlyph&	glyph  = *job.m_glyph;
+		const ImFontConfig& config = *job.m_source->m_config;
+
+		const int rect_x0 = int(glyph.U0 * atlas->TexWidth + 0.5f) * scale;
+		const int rect_y0 = int(glyph.V0 * atlas->TexHeight + 0.5f) * scale;
+		const int rect_x1 = int(glyph.U1 * atlas->TexWidth + 0.5f) * scale;
+		const int rect_y1 = int(glyph.V1 * atlas->TexHeight + 0.5f) * scale;
+		if (rect_x1 <= rect_x0 || rect_y1 <= rect_y0 || glyph.X1 <= glyph.X0 || glyph.Y1 <= glyph.Y0)
+		{
+			return;
+		}
+
+		const float density_x = float(rect_x1 - rect_x0) / (glyph.X1 - glyph.X0);
+		const float density_y = float(rect_y1 - rect_y0) / (glyph.Y1 - glyph.Y0);
+		const float left	  = (glyph.X0 - config.GlyphOffset.x) * density_x;
+		const float top		  = (glyph.Y0 - config.GlyphOffset.y - IM_ROUND(job.m_font->Ascent)) * density_y;
+		const float origin_x  = std::ceil(left);
+		const float origin_y  = std::ceil(top);
+
+		const stbtt_fontinfo& info		  = job.m_source->m_info;
+		const float			  font_scale  = job.m_source->m_scale;
+		const int			  glyph_index = stbtt_FindGlyphIndex(&info, glyph.Codepoint);
+
+		int			   bitmap_width = 0, bitmap_height = 0, offset_x = 0, offset_y = 0;
+		unsigned char* bitmap		= stbtt_GetGlyphBitmapSubpixel(
+			&info, font_scale * density_x, font_scale * density_y, origin_x - left, origin_y - top, glyph_index, &bitmap_width, &bitmap_height, &offset_x, &offset_y);
+
+		const int dst_x = rect_x0 + offset_x - int(origin_x);
+		const int dst_y = rect_y0 + offset_y - int(origin_y);
+		for (int y = rect_y0; y < rect_y1; ++y)
+		{
+			for (int x = rect_x0; x < rect_x1; ++x)
+			{
+				const int	bx	   = x - dst_x;
+				const int	by	   = y - dst_y;
+				const bool	inside = bitmap && bx >= 0 && by >= 0 && bx < bitmap_width && by < bitmap_height;
+				const float value  = inside ? bitmap[by * bitmap_width + bx] * config.RasterizerMultiply : 0.0f;
+
+				uint8_t* texel = pixels + size_t(y) * pitch + size_t(x) * bytes_per_pixel;
+				std::memset(texel, 255, bytes_per_pixel - 1);
+				texel[bytes_per_pixel - 1] = uint8_t(std::min(255.0f, value));
+			}
+		}
+
+		if (bitmap)
+		{
+			stbtt_FreeBitmap(bitmap, nullptr);
+		}
+	}
+};
+
+// Rolling window of the last k_capacity samples, summarized when statistics are queried.
+struct timing_window
+{
+	static constexpr size_t k_capacity = 512;
+
+	std::array<double, k_capacity> m_samples{};
+	size_t						   m_count = 0;
+	size_t						   m_next  = 0;
+
+	void add(double value)
+	{
+		m_samples[m_next] = value;
+		m_next			  = (m_next + 1) % k_capacity;
+		m_count			  = std::min(m_count + 1, k_capacity);
+	}
+
+	imgui_app_fw_interface::gpu_timing summary() const
+	{
+		imgui_app_fw_interface::gpu_timing result;
+		if (m_count == 0)
+		{
+			return result;
+		}
+
+		std::array<double, k_capacity> sorted;
+		std::copy_n(m_samples.begin(), m_count, sorted.begin());
+		std::sort(sorted.begin(), sorted.begin() + m_count);
+
+		double sum = 0.0;
+		for (size_t i = 0; i < m_count; ++i)
+		{
+			sum += sorted[i];
+		}
+
+		result.samples = m_count;
+		result.min_ms  = sorted[0];
+		result.avg_ms  = sum / double(m_count);
+		result.p99_ms  = sorted[std::min(m_count - 1, m_count * 99 / 100)];
+		return result;
+	}
+};
+
+// Timestamp queries of one viewport. Each recorded frame takes the next of k_slots query ranges, which is read back without
+// waiting when its slot comes around again (queries the GPU hasn't reached yet are dropped) and then reset.
+struct gpu_timer
+{
+	static constexpr uint32_t k_slots			 = 4;  // one more than the most frames in flight
+	static constexpr uint32_t k_max_callbacks	 = 16; // timed per frame, later ones run untimed
+	static constexpr uint32_t k_queries_per_slot = 2 + 2 * k_max_callbacks;
+	static constexpr uint32_t k_pass_begin		 = 0;
+	static constexpr uint32_t k_pass_end		 = 1;
+
+	const FGC::VulkanDevice2*					 m_device	   = nullptr;
+	VkQueryPool									 m_pool		   = VK_NULL_HANDLE;
+	bool										 m_unsupported = false; // the graphics queue writes no timestamps
+	double										 m_tick_ms	   = 0.0;
+	uint64_t									 m_valid_mask  = 0ull;
+	std::array<uint32_t, k_slots>				 m_callbacks{}; // callbacks timed in each slot
+	std::array<bool, k_slots>					 m_used{};
+	std::array<int64_t, k_slots>				 m_record_ns{}; // steady clock time each slot's frame started recording
+	uint32_t									 m_slot = 0;
+	FG::Task									 m_reset_task;
+	std::array<uint64_t, 2 * k_queries_per_slot> m_results; // value and availability of each query
+
+	static constexpr uint32_t callback_begin(uint32_t callback)
+	{
+		return 2 + 2 * callback;
+	}
+
+	static VkCommandBuffer command_buffer(const FG::CustomTask::Context_t& context)
+	{
+		return FGC::BitCast<VkCommandBuffer>(std::get<FG::VulkanCommandBuffer>(context).cmdBuffer);
+	}
+
+	bool create(const FGC::VulkanDevice2& device)
+	{
+		uint32_t family = 0;
+		for (auto& q : device.GetVkQueues())
+		{
+			if (q.familyFlags & VK_QUEUE_GRAPHICS_BIT)
+			{
+				family = q.familyIndex;
+				break;
+			}
+		}
+
+		uint32_t family_count = 0;
+		vkGetPhysicalDeviceQueueFamilyProperties(device.GetVkPhysicalDevice(), OUT &family_count, nullptr);
+		std::vector<VkQueueFamilyProperties> families(family_count);
+		vkGetPhysicalDeviceQueueFamilyProperties(device.GetVkPhysicalDevice(), INOUT &family_count, OUT families.data());
+
+		const uint32_t valid_bits = family < family_count ? families[family].timestampValidBits : 0;
+		if (valid_bits == 0)
+		{
+			m_unsupported = true;
+			return false;
+		}
+
+		VkQueryPoolCreateInfo info = {};
+		info.sType		= VK_STRUCTURE_TYPE_QUERY_POOL_CREATE_INFO;
+		info.queryType	= VK_QUERY_TYPE_TIMESTAMP;
+		info.queryCount = k_slots * k_queries_per_slot;
+		CHECK_ERR(device.vkCreateQueryPool(device.GetVkDevice(), &info, nullptr, OUT & m_pool) == VK_SUCCESS);
+
+		m_device	 = &device;
+		m_tick_ms	 = double(device.GetProperties().properties.limits.timestampPeriod) * 1e-6;
+		m_valid_mask = valid_bits >= 64 ? ~0ull : (1ull << valid_bits) - 1;
+		m_used.fill(false);
+		return true;
+	}
+
+	// Only once the GPU is done with the pool, the viewport's swapchain is already gone by then.
+	void destroy()
+	{
+		if (m_pool != VK_NULL_HANDLE)
+		{
+			m_device->vkDestroyQueryPool(m_device->GetVkDevice(), m_pool, nullptr);
+			m_pool = VK_NULL_HANDLE;
+		}
+	}
+
+	// Reads back the slot this frame reuses, passing sink(is_callback, milliseconds, gpu_start_ns, record_ns) each finished range,
+	// and records its reset. gpu_start_ns is in the GPU's clock, record_ns when the range's frame started recording.
+	template<typename T_SINK>
+	bool begin_frame(const FGC::VulkanDevice2& device, const FG::CommandBuffer& cmdbuf, T_SINK&& sink)
+	{
+		if (m_unsupported || (m_pool == VK_NULL_HANDLE && !create(device)))
+		{
+			return false;
+		}
+
+		m_slot = (m_slot + 1) % k_slots;
+
+		const uint32_t first = m_slot * k_queries_per_slot;
+		if (m_used[m_slot])
+		{
+			read(first, m_callbacks[m_slot], m_record_ns[m_slot], sink);
+		}
+		m_used[m_slot]		= true;
+		m_callbacks[m_slot] = 0;
+		m_record_ns[m_slot] = steady_clock_ns();
+
+		const FGC::VulkanDevice2* vk   = m_device;
+		const VkQueryPool		  pool = m_pool;
+
+		m_reset_task = cmdbuf->AddTask(FG::CustomTask{[vk, pool, first](FG::CustomTask::Context_t context) {
+			vk->vkCmdResetQueryPool(command_buffer(context), pool, first, k_queries_per_slot);
+		}});
+		return true;
+	}
+
+	// Writes once all work before it finished, add dependencies to place it after the work to time.
+	FG::CustomTask timestamp(uint32_t query) const
+	{
+		const FGC::VulkanDevice2* vk	= m_device;
+		const VkQueryPool		  pool	= m_pool;
+		const uint32_t			  index = m_slot * k_queries_per_slot + query;
+
+		FG::CustomTask task{[vk, pool, index](FG::CustomTask::Context_t context) {
+			vk->vkCmdWriteTimestamp(command_buffer(context), VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, pool, index);
+		}};
+		task.DependsOn(m_reset_task);
+		return task;
+	}
+
+	// Returns the callback's index in this frame, or -1 once k_max_callbacks were timed.
+	int next_callback()
+	{
+		return m_callbacks[m_slot] < k_max_callbacks ? int(m_callbacks[m_slot]++) : -1;
+	}
+
+	template<typename T_SINK>
+	void read(uint32_t first, uint32_t callbacks, int64_t record_ns, T_SINK& sink)
+	{
+		const uint32_t count  = 2 + 2 * callbacks;
+		const VkResult result = m_device->vkGetQueryPoolResults(m_device->GetVkDevice(), m_pool, first, count, count * 2 * sizeof(uint64_t), OUT m_results.data(),
+																2 * sizeof(uint64_t), VK_QUERY_RESULT_64_BIT | VK_QUERY_RESULT_WITH_AVAILABILITY_BIT);
+		if (result != VK_SUCCESS && result != VK_NOT_READY)
+		{
+			return;
+		}
+
+		const auto elapsed = [this](uint32_t begin, OUT double& ms, OUT int64_t& start_ns) {
+			const uint64_t* start = &m_results[2 * begin];
+			const uint64_t* end	  = &m_results[2 * (begin + 1)];
+			if (!start[1] || !end[1])
+			{
+				return false;
+			}
+			ms		 = double((end[0] - start[0]) & m_valid_mask) * m_tick_ms;
+			start_ns = int64_t(double(start[0] & m_valid_mask) * m_tick_ms * 1e6);
+			return true;
+		};
+
+		double	ms		 = 0.0;
+		int64_t start_ns = 0;
+		if (elapsed(k_pass_begin, OUT ms, OUT start_ns))
+		{
+			sink(false, ms, start_ns, record_ns);
+		}
+		for (uint32_t i = 0; i < callbacks; ++i)
+		{
+			if (elapsed(callback_begin(i), OUT ms, OUT start_ns))
+			{
+				sink(true, ms, start_ns, record_ns);
+			}
+		}
+	}
+};
+
+// Per-frame totals for the performance HUD. Recording threads add each viewport's counts at once, end_frame() collects them.
+struct frame_counters
+{
+	std::atomic<uint64_t> m_draw_calls{0};
+	std::atomic<uint64_t> m_fg_tasks{0};
+	std::atomic<uint64_t> m_vertices{0};
+	std::atomic<uint64_t> m_indices{0};
+	std::atomic<uint64_t> m_upload_bytes{0};
+	std::atomic<uint64_t> m_swapchain_recreations{0}; // since init, collect() leaves it
+
+	struct snapshot
+	{
+		uint64_t m_draw_calls			 = 0;
+		uint64_t m_fg_tasks				 = 0;
+		uint64_t m_vertices				 = 0;
+		uint64_t m_indices				 = 0;
+		uint64_t m_upload_bytes			 = 0;
+		uint64_t m_swapchain_recreations = 0;
+	};
+
+	void add_uploads(uint64_t tasks, uint64_t bytes)
+	{
+		m_fg_tasks.fetch_add(tasks, std::memory_order_relaxed);
+		m_upload_bytes.fetch_add(bytes, std::memory_order_relaxed);
+	}
+
+	snapshot collect()
+	{
+		snapshot result;
+		result.m_draw_calls			   = m_draw_calls.exchange(0, std::memory_order_relaxed);
+		result.m_fg_tasks			   = m_fg_tasks.exchange(0, std::memory_order_relaxed);
+		result.m_vertices			   = m_vertices.exchange(0, std::memory_order_relaxed);
+		result.m_indices			   = m_indices.exchange(0, std::memory_order_relaxed);
+		result.m_upload_bytes		   = m_upload_bytes.exchange(0, std::memory_order_relaxed);
+		result.m_swapchain_recreations = m_swapchain_recreations.load(std::memory_order_relaxed);
+		return result;
+	}
+};
+
+// FG::ArraySizeOf() only takes vectors with the default allocator
+template<typename T>
+FG::BytesU bytes_of(const std::pmr::vector<T>& v)
+{
+	return FG::BytesU{v.size() * sizeof(T)};
+}
+
+struct imgui_renderer_window
+{
+	// Everything the GPU reads while drawing a frame. Each frame in flight writes its own set, so recording frame N+1 never
+	// has to wait for the GPU to finish reading frame N's buffers.
+	struct frame_resources
+	{
+		FG::BufferID m_vertex_buffer;
+		FG::BufferID m_index_buffer;
+		FG::BufferID m_uniform_buffer;
+		FG::BufferID m_indirect_buffer;
+		FG::BufferID m_draw_data_buffer;
+
+		FG::BytesU m_vertex_buf_size;
+		FG::BytesU m_index_buf_size;
+		FG::BytesU m_indirect_buf_size;
+		FG::BytesU m_draw_data_buf_size;
+
+		FG::PipelineResources m_resources;
+		FG::PipelineResources m_indirect_resources;
+	};
+
+	static constexpr uint32_t k_max_frames_in_flight = 3;
+
+	std::array<frame_resources, k_max_frames_in_flight> m_frames;
+	uint32_t											m_frame_index = 0;
+
+	// The per-frame vectors below live in the viewport's frame arena, release_transients() drops them before it is reset.
+	explicit imgui_renderer_window(std::pmr::memory_resource* arena) :
+		m_upload_copies{arena}, m_repacked_indices{arena}, m_packed_vertices{arena}, m_indirect_cmds{arena}, m_indirect_draws{arena}, m_pass_dependencies{arena}
+	{
+	}
+
+	void release_transients()
+	{
+		release(m_upload_copies);
+		release(m_repacked_indices);
+		release(m_packed_vertices);
+		release(m_indirect_cmds);
+		release(m_indirect_draws);
+		release(m_pass_dependencies);
+	}
+
+	template<typename T>
+	static void release(std::pmr::vector<T>& v)
+	{
+		v = std::pmr::vector<T>{v.get_allocator()};
+	}
+
+	frame_resources& frame()
+	{
+		return m_frames[m_frame_index];
+	}
+
+	std::map<ImTextureID, FG::ImageID> m_texture_cache;
+
+	struct upload_copy
+	{
+		uint8_t*	   m_dst;
+		const uint8_t* m_src;
+		size_t		   m_size;
+	};
+	std::pmr::vector<upload_copy> m_upload_copies; // parallel upload path
+
+	FG::EIndex				   m_index_type = FG::EIndex::UShort; // format of the indices uploaded this frame
+	std::pmr::vector<uint16_t> m_repacked_indices;
+
+	bool						   m_compact_vertices = false; // format of the vertices uploaded this frame
+	std::pmr::vector<compact_vert> m_packed_vertices;
+
+	// multi-draw-indirect path
+	struct indirect_draw_data
+	{
+		FG::float4 m_clip_rect; // framebuffer pixels, left/top inclusive, right/bottom exclusive
+		FG::uint   m_texture_index;
+		FG::uint   m_padding[3];
+	};
+	std::pmr::vector<VkDrawIndexedIndirectCommand> m_indirect_cmds;
+	std::pmr::vector<indirect_draw_data>		   m_indirect_draws;
+
+	// partial redraw: scissors are intersected with this framebuffer rect
+	FG::RectI m_damage_rect;
+	bool	  m_clip_to_damage = false;
+
+	// atlas picked for the viewport's DPI scale this frame, null draws with the base atlas
+	FG::RawImageID m_font_texture;
+
+	// GPU profiling: set while this frame is timed, draw() then brackets the pass and user callbacks with timestamps
+	gpu_timer*				   m_timer = nullptr;
+	std::pmr::vector<FG::Task> m_pass_dependencies; // what the pass waits for, its begin timestamp waits for the same
+
+	// HUD counts of the frame being recorded, draw() moves them into imgui_renderer_t::m_counters
+	uint32_t m_frame_draw_calls	  = 0;
+	uint32_t m_frame_tasks		  = 0;
+	uint64_t m_frame_upload_bytes = 0;
+
+	template<typename T_TASK>
+	FG::Task add_task(const FG::CommandBuffer& cmdbuf, T_TASK&& task)
+	{
+		++m_frame_tasks;
+		return cmdbuf->AddTask(std::forward<T_TASK>(task));
+	}
+
+	// retained layers: textures referenced through ImDrawCmd::TextureId, they hold premultiplied alpha
+	std::vector<std::pair<ImTextureID, FG::RawImageID>> m_layer_textures;
+	bool												m_premultiplied_output = false; // drawing into a layer
+
+	FG::RawImageID find_layer_texture(ImTextureID id) const
+	{
+		for (const auto& [texture_id, image] : m_layer_textures)
+		{
+			if (texture_id == id)
+			{
+				return image;
+			}
+		}
+		return {};
+	}
+};
+
+template<typename T_INDEX>
+struct imgui_renderer_t
+{
+	static_assert(sizeof(T_INDEX) == 2 || sizeof(T_INDEX) == 4, "ImDrawIdx must be a 16 or 32 bit unsigned integer");
+
+	using index_t = T_INDEX;
+
+	static constexpr FG::EIndex k_index_type = sizeof(T_INDEX) == 2 ? FG::EIndex::UShort : FG::EIndex::UInt;
+
+	FG::ImageID		  m_font_texture;
+	FG::ImageViewDesc m_font_view; // R8 atlases are sampled through a (1, 1, 1, R) swizzle, so the shaders don't change
+	FG::SamplerID	  m_font_sampler;
+	FG::GPipelineID	  m_pipeline;
+	bool			  m_alpha_font_atlas = false; // only for atlases whose custom rects hold no colored pixels
+	uint64_t		  m_font_atlas_bytes = 0;
+	double			  m_font_upload_ms	 = 0.0;
+	double			  m_font_build_ms	 = 0.0;
+	worker_pool*	  m_workers			 = nullptr;
+	bool			  m_parallel_upload	 = false;
+	bool			  m_repack_indices	 = true; // only meaningful with 32 bit ImDrawIdx
+	bool			  m_compact_vertices = false;
+	uint32_t		  m_frames_in_flight = 2; // resource sets cycled per window, 1..imgui_renderer_window::k_max_frames_in_flight
+
+	// built once in init_shared, draw() only selects one
+	FG::VertexInputState m_vertex_input;
+	FG::VertexInputState m_compact_vertex_input;
+
+	FG::GPipelineID m_indirect_pipeline;
+	bool			m_supports_indirect_draw = false; // multiDrawIndirect and drawIndirectFirstInstance
+	bool			m_indirect_draw			 = false;
+
+	// SDF font mode: the atlas holds distance and font draws use these pipelines, created on first use
+	FG::GPipelineID	 m_sdf_pipeline;
+	FG::GPipelineID	 m_indirect_sdf_pipeline;
+	sdf_font_builder m_sdf;
+	bool			 m_sdf_fonts = false;
+
+	// the first atlas build runs on this thread while the device and framegraph are created
+	std::thread		 m_font_builder;
+	font_atlas_cache m_atlas_cache;
+
+	// per-monitor DPI: atlases re-rendered at integer scales, created when a viewport draws at that scale, evicted once unused
+	struct dpi_atlas
+	{
+		int									  m_scale = 0;
+		FG::ImageID							  m_texture;
+		uint64_t							  m_generation = 0; // m_font_generation the texture was built from
+		uint64_t							  m_bytes	   = 0;
+		std::chrono::steady_clock::time_point m_last_used; // ImGui thread only, recording never reads it
+	};
+
+	static constexpr int k_max_dpi_scale	  = 4;
+	static constexpr int k_max_dpi_atlas_size = 8192; // larger scales fall back to a smaller one
+
+	std::vector<dpi_atlas> m_dpi_atlases;	 // only changed by update_dpi_atlases(), with the render thread idle
+	std::vector<int>	   m_new_dpi_scales; // ImGui thread, queued by use_dpi_scale() for update_dpi_atlases()
+	dpi_atlas_builder	   m_dpi_builder;
+	std::vector<uint8_t>   m_dpi_pixels;
+	uint64_t			   m_font_generation   = 0; // bumped by every atlas upload, DPI atlases built from an older one are rebuilt
+	bool				   m_dpi_font_atlases  = true;
+	double				   m_dpi_atlas_timeout = 30.0; // seconds a DPI atlas survives without a viewport drawing at its scale
+	uint64_t			   m_dpi_atlas_bytes   = 0;
+
+	frame_counters m_counters; // read by the performance HUD
+
+	// below this much vertex + index data a frame is uploaded with one UpdateBuffer per draw list on the calling thread
+	static constexpr size_t k_parallel_upload_threshold = 1024 * 1024;
+	// staging allocations are split so a single one never exceeds the framegraph staging buffer size
+	static constexpr size_t k_staging_chunk_size = 4 * 1024 * 1024;
+	// copies are split further so workers get evenly sized items even when one draw list dominates
+	static constexpr size_t k_copy_granularity = 256 * 1024;
+
+	bool init_shared(ImGuiContext* _context, const FG::FrameGraph& fg)
+	{
+		m_vertex_input.Bind(FG::VertexBufferID(), FG::SizeOf<ImDrawVert>);
+		m_vertex_input.Add(FG::VertexID("aPos"), FG::EVertexType::Float2, FG::OffsetOf(&ImDrawVert::pos));
+		m_vertex_input.Add(FG::VertexID("aUV"), FG::EVertexType::Float2, FG::OffsetOf(&ImDrawVert::uv));
+		m_vertex_input.Add(FG::VertexID("aColor"), FG::EVertexType::UByte4_Norm, FG::OffsetOf(&ImDrawVert::col));
+
+		// Short2_Scaled keeps quarter pixel units, update_uniform_buffer folds the 1/4 and the origin into uScale/uTranslate
+		m_compact_vertex_input.Bind(FG::VertexBufferID(), FG::SizeOf<compact_vert>);
+		m_compact_vertex_input.Add(FG::VertexID("aPos"), FG::EVertexType::Short2_Scaled, FG::OffsetOf(&compact_vert::pos));
+		m_compact_vertex_input.Add(FG::VertexID("aUV"), FG::EVertexType::UShort2_Norm, FG::OffsetOf(&compact_vert::uv));
+		m_compact_vertex_input.Add(FG::VertexID("aColor"), FG::EVertexType::UByte4_Norm, FG::OffsetOf(&compact_vert::col));
+
+		CHECK_ERR(create_pipeline(fg, false, OUT m_pipeline));
+		CHECK_ERR(create_sampler(fg));
+
+		if (m_supports_indirect_draw)
+		{
+			CHECK_ERR(create_indirect_pipeline(fg, false, OUT m_indirect_pipeline));
+		}
+
+		// usually started before device creation and already done
+		finish_font_build(_context);
+		return true;
+	}
+
+	bool init(imgui_renderer_window& pw, ImGuiContext* _context, const FG::FrameGraph& fg)
+	{
+		CHECK_ERR(init_pipeline(pw, fg));
+		if (m_indirect_pipeline)
+		{
+			for (auto& frame : pw.m_frames)
+			{
+				CHECK_ERR(fg->InitPipelineResources(m_indirect_pipeline, FG::DescriptorSetID("0"), OUT frame.m_indirect_resources));
+			}
+		}
+		return true;
+	}
+
+	void destroy(imgui_renderer_window& pw, const FG::FrameGraph& fg)
+	{
+		if (fg)
+		{
+			for (auto& frame : pw.m_frames)
+			{
+				fg->ReleaseResource(INOUT frame.m_vertex_buffer);
+				fg->ReleaseResource(INOUT frame.m_index_buffer);
+				fg->ReleaseResource(INOUT frame.m_uniform_buffer);
+				fg->ReleaseResource(INOUT frame.m_indirect_buffer);
+				fg->ReleaseResource(INOUT frame.m_draw_data_buffer);
+			}
+		}
+	}
+
+	void destroy_shared(const FG::FrameGraph& fg)
+	{
+		if (fg)
+		{
+			fg->ReleaseResource(INOUT m_font_texture);
+			for (dpi_atlas& atlas : m_dpi_atlases)
+			{
+				fg->ReleaseResource(INOUT atlas.m_texture);
+			}
+			m_dpi_atlases.clear();
+			m_new_dpi_scales.clear();
+			fg->ReleaseResource(INOUT m_font_sampler);
+			fg->ReleaseResource(INOUT m_pipeline);
+			fg->ReleaseResource(INOUT m_indirect_pipeline);
+			fg->ReleaseResource(INOUT m_sdf_pipeline);
+			fg->ReleaseResource(INOUT m_indirect_sdf_pipeline);
+		}
+	}
+
+	template<typename T_USERDRAW_HANDLER>
+	FG::Task draw(
+		imgui_renderer_window& pw, ImDrawData* draw_data, ImGuiContext* _context, const FG::CommandBuffer& cmdbuf, FG::LogicalPassID pass_id, FG::ArrayView<FG::Task> dependencies,
+		T_USERDRAW_HANDLER userdraw_handler = [](const ImDrawList& cmd_list, const ImDrawCmd& cmd, FG::Task timestamp) -> FG::Task { return nullptr; })
+	{
+		IMGUI_APP_FW_PROFILE_SCOPE(draw);
+
+		pw.m_frame_index = (pw.m_frame_index + 1) % m_frames_in_flight;
+
+		imgui_renderer_window::frame_resources& frame = pw.frame();
+
+		CHECK_ERR(cmdbuf and _context);
+
+		ASSERT(draw_data->TotalVtxCount > 0);
+
+		int fb_width  = (int)(draw_data->DisplaySize.x * draw_data->FramebufferScale.x);
+		int fb_height = (int)(draw_data->DisplaySize.y * draw_data->FramebufferScale.y);
+
+		if (fb_width <= 0 || fb_height <= 0)
+		{
+			return nullptr;
+		}
+
+		FG::SubmitRenderPass submit{pass_id};
+
+		pw.m_pass_dependencies.clear();
+		const auto depend = [&submit, &pw](FG::Task task) {
+			submit.DependsOn(task);
+			if (pw.m_timer && task)
+			{
+				pw.m_pass_dependencies.push_back(task);
+			}
+		};
+
+		depend(create_buffers(pw, draw_data, _context, cmdbuf));
+		depend(update_uniform_buffer(pw, draw_data, _context, cmdbuf));
+
+		for (auto dep : dependencies)
+		{
+			depend(dep);
+		}
+
+		const FG::VertexInputState& vert_input = pw.m_compact_vertices ? m_compact_vertex_input : m_vertex_input;
+
+		// the indirect pipeline only binds the font atlas and blends straight alpha
+		const bool can_draw_indirect = m_indirect_draw && m_indirect_pipeline && pw.m_layer_textures.empty() && !pw.m_premultiplied_output;
+
+		if (can_draw_indirect && build_indirect_draws(pw, draw_data))
+		{
+			depend(upload_indirect_draws(pw, cmdbuf));
+
+			frame.m_indirect_resources.BindBuffer(FG::UniformID("uPushConstant"), frame.m_uniform_buffer);
+			frame.m_indirect_resources.BindBuffer(FG::UniformID("DrawData"), frame.m_draw_data_buffer);
+			frame.m_indirect_resources.BindTexture(FG::UniformID("sTexture"), font_texture(pw), m_font_sampler, m_font_view);
+
+			++pw.m_frame_draw_calls;
+			cmdbuf->AddTask(
+				pass_id, FG::DrawIndexedIndirect{}
+							 .SetPipeline(m_sdf_fonts && m_indirect_sdf_pipeline ? m_indirect_sdf_pipeline.Get() : m_indirect_pipeline.Get())
+							 .AddResources(FG::DescriptorSetID{"0"}, frame.m_indirect_resources)
+							 .AddVertexBuffer(FG::VertexBufferID(), frame.m_vertex_buffer)
+							 .SetVertexInput(vert_input)
+							 .SetTopology(FG::EPrimitive::TriangleList)
+							 .SetIndexBuffer(frame.m_index_buffer, (FG::BytesU)0, pw.m_index_type)
+							 .SetIndirectBuffer(frame.m_indirect_buffer)
+							 .AddColorBuffer(FG::RenderTargetID::Color_0, FG::EBlendFactor::SrcAlpha, FG::EBlendFactor::OneMinusSrcAlpha, FG::EBlendOp::Add)
+							 .SetDepthTestEnabled(false)
+							 .SetCullMode(FG::ECullMode::None)
+							 .Draw(FG::uint(pw.m_indirect_cmds.size()), (FG::BytesU)0, FG::SizeOf<VkDrawIndexedIndirectCommand>));
+
+			return add_counted_pass(pw, draw_data, cmdbuf, submit);
+		}
+
+		FG::uint global_idx_offset = 0;
+		FG::uint global_vtx_offset = 0;
+
+		// layers hold color, only the font atlas goes through the SDF variant
+		const FG::RawGPipelineID font_pipeline = m_sdf_fonts && m_sdf_pipeline ? m_sdf_pipeline.Get() : m_pipeline.Get();
+
+		ImVec2 clip_off	  = draw_data->DisplayPos;		 // (0,0) unless using multi-viewports
+		ImVec2 clip_scale = draw_data->FramebufferScale; // (1,1) unless using retina display which are often (2,2)
+
+		frame.m_resources.BindBuffer(FG::UniformID("uPushConstant"), frame.m_uniform_buffer);
+
+		for (int i = 0; i < draw_data->CmdListsCount; ++i)
+		{
+			const ImDrawList& cmd_list = *draw_data->CmdLists[i];
+
+			for (int j = 0; j < cmd_list.CmdBuffer.Size; ++j)
+			{
+				const ImDrawCmd& cmd = cmd_list.CmdBuffer[j];
+
+				if (cmd.UserCallback)
+				{
+					if (cmd.UserCallback == ImDrawCallback_ResetRenderState)
+					{
+						// state is bound to the draw tasks, so this isn't needed?
+					}
+					else
+					{
+						depend(call_user_callback(pw, cmdbuf, cmd_list, cmd, userdraw_handler));
+					}
+				}
+				else
+				{
+					FG::RectI scissor;
+					scissor.left   = int((cmd.ClipRect.x - clip_off.x) * clip_scale.x);
+					scissor.top	   = int((cmd.ClipRect.y - clip_off.y) * clip_scale.y);
+					scissor.right  = int((cmd.ClipRect.z - clip_off.x) * clip_scale.x);
+					scissor.bottom = int((cmd.ClipRect.w - clip_off.y) * clip_scale.y);
+
+					if (pw.m_clip_to_damage)
+					{
+						scissor.left   = std::max(scissor.left, pw.m_damage_rect.left);
+						scissor.top	   = std::max(scissor.top, pw.m_damage_rect.top);
+						scissor.right  = std::min(scissor.right, pw.m_damage_rect.right);
+						scissor.bottom = std::min(scissor.bottom, pw.m_damage_rect.bottom);
+					}
+
+					if (scissor.left < fb_width && scissor.top < fb_height && scissor.right >= 0.0f && scissor.bottom >= 0.0f && scissor.left < scissor.right &&
+						scissor.top < scissor.bottom)
+					{
+						// Negative offsets are illegal for vkCmdSetScissor
+						if (scissor.left < 0)
+						{
+							scissor.left = 0;
+						}
+
+						if (scissor.top < 0)
+						{
+							scissor.top = 0;
+						}
+
+						const FG::RawImageID layer = cmd.TextureId ? pw.find_layer_texture(cmd.TextureId) : FG::RawImageID{};
+
+						if (layer)
+						{
+							frame.m_resources.BindTexture(FG::UniformID("sTexture"), layer, m_font_sampler);
+						}
+						else if (cmd.TextureId)
+						{
+							// frame.m_resources.BindTexture(FG::UniformID("sTexture"), static_cast<FG::RawImageID>(cmd.TextureId), m_font_sampler);
+							frame.m_resources.BindTexture(FG::UniformID("sTexture"), font_texture(pw), m_font_sampler, m_font_view);
+						}
+						else
+						{
+							frame.m_resources.BindTexture(FG::UniformID("sTexture"), font_texture(pw), m_font_sampler, m_font_view);
+						}
+
+						FG::DrawIndexed draw_task;
+						draw_task.SetPipeline(layer ? m_pipeline.Get() : font_pipeline)
+							.AddResources(FG::DescriptorSetID{"0"}, frame.m_resources)
+							.AddVertexBuffer(FG::VertexBufferID(), frame.m_vertex_buffer)
+							.SetVertexInput(vert_input)
+							.SetTopology(FG::EPrimitive::TriangleList)
+							.SetIndexBuffer(frame.m_index_buffer, (FG::BytesU)0, pw.m_index_type)
+							.SetDepthTestEnabled(false)
+							.SetCullMode(FG::ECullMode::None)
+							.Draw(cmd.ElemCount, 1, cmd.IdxOffset + global_idx_offset, int(cmd.VtxOffset + global_vtx_offset), 0)
+							.AddScissor(scissor);
+
+						if (layer)
+						{
+							// layer texels are already multiplied by their alpha
+							draw_task.AddColorBuffer(FG::RenderTargetID::Color_0, FG::EBlendFactor::One, FG::EBlendFactor::OneMinusSrcAlpha, FG::EBlendOp::Add);
+						}
+						else if (pw.m_premultiplied_output)
+						{
+							// accumulate premultiplied color so the layer composites like the original draws would have blended
+							draw_task.AddColorBuffer(FG::RenderTargetID::Color_0, FG::EBlendFactor::SrcAlpha, FG::EBlendFactor::One, FG::EBlendFactor::OneMinusSrcAlpha,
+													 FG::EBlendFactor::OneMinusSrcAlpha, FG::EBlendOp::Add, FG::EBlendOp::Add);
+						}
+						else
+						{
+							draw_task.AddColorBuffer(FG::RenderTargetID::Color_0, FG::EBlendFactor::SrcAlpha, FG::EBlendFactor::OneMinusSrcAlpha, FG::EBlendOp::Add);
+						}
+
+						cmdbuf->AddTask(pass_id, draw_task);
+						++pw.m_frame_draw_calls;
+					}
+				}
+			}
+
+			global_idx_offset += cmd_list.IdxBuffer.Size;
+			global_vtx_offset += cmd_list.VtxBuffer.Size;
+		}
+
+		return add_counted_pass(pw, draw_data, cmdbuf, submit);
+	}
+
+	// Adds the pass and moves the window's HUD counts of this frame into m_counters.
+	FG::Task add_counted_pass(imgui_renderer_window& pw, const ImDrawData* draw_data, const FG::CommandBuffer& cmdbuf, FG::SubmitRenderPass& submit)
+	{
+		const FG::Task pass = add_pass(pw, cmdbuf, submit);
+
+		m_counters.m_draw_calls.fetch_add(pw.m_frame_draw_calls, std::memory_order_relaxed);
+		m_counters.m_fg_tasks.fetch_add(pw.m_frame_tasks, std::memory_order_relaxed);
+		m_counters.m_vertices.fetch_add(uint64_t(draw_data->TotalVtxCount), std::memory_order_relaxed);
+		m_counters.m_indices.fetch_add(uint64_t(draw_data->TotalIdxCount), std::memory_order_relaxed);
+		m_counters.m_upload_bytes.fetch_add(pw.m_frame_upload_bytes, std::memory_order_relaxed);
+
+		pw.m_frame_draw_calls	= 0;
+		pw.m_frame_tasks		= 0;
+		pw.m_frame_upload_bytes = 0;
+		return pass;
+	}
+
+	// While profiling, the callback's tasks are timed from a timestamp it can depend on (mutable_userdata::m_timestamp_task)
+	// until the task it returns completes.
+	template<typename T_USERDRAW_HANDLER>
+	static FG::Task call_user_callback(imgui_renderer_window& pw, const FG::CommandBuffer& cmdbuf, const ImDrawList& cmd_list, const ImDrawCmd& cmd, T_USERDRAW_HANDLER& handler)
+	{
+		const int callback = pw.m_timer ? pw.m_timer->next_callback() : -1;
+		if (callback < 0)
+		{
+			return handler(cmd_list, cmd, FG::Task{});
+		}
+
+		const uint32_t begin = gpu_timer::callback_begin(uint32_t(callback));
+		FG::Task	   task	 = handler(cmd_list, cmd, pw.add_task(cmdbuf, pw.m_timer->timestamp(begin)));
+		if (!task)
+		{
+			return nullptr; // nothing to time, the end query stays unwritten and the sample is dropped
+		}
+		return pw.add_task(cmdbuf, pw.m_timer->timestamp(begin + 1).DependsOn(task));
+	}
+
+	// While profiling, the pass is bracketed by timestamps, the first one written once everything the pass waits for is done.
+	static FG::Task add_pass(imgui_renderer_window& pw, const FG::CommandBuffer& cmdbuf, FG::SubmitRenderPass& submit)
+	{
+		if (!pw.m_timer)
+		{
+			return pw.add_task(cmdbuf, submit);
+		}
+
+		FG::CustomTask begin = pw.m_timer->timestamp(gpu_timer::k_pass_begin);
+		for (FG::Task task : pw.m_pass_dependencies)
+		{
+			begin.DependsOn(task);
+		}
+		submit.DependsOn(pw.add_task(cmdbuf, begin));
+
+		const FG::Task pass = pw.add_task(cmdbuf, submit);
+		return pw.add_task(cmdbuf, pw.m_timer->timestamp(gpu_timer::k_pass_end).DependsOn(pass));
+	}
+
+	// GLSL for sample_texture(), the SDF variant turns the distance in alpha into coverage, antialiased over about one screen
+	// pixel at any scale. Texels outside glyphs (the white pixel, custom rects) are opaque and stay opaque.
+	static const char* sample_texture_glsl(bool sdf_font)
+	{
+		if (sdf_font)
+		{
+			return R"#(
+			vec4 sample_texture(vec2 uv)
+			{
+				vec4  texel = texture(sTexture, uv);
+				float width = max(fwidth(texel.a) * 0.7, 1.0 / 255.0);
+				return vec4(texel.rgb, smoothstep(0.5 - width, 0.5 + width, texel.a));
+			}
+			)#";
+		}
+		return R"#(
+			vec4 sample_texture(vec2 uv)
+			{
+				return texture(sTexture, uv);
+			}
+			)#";
+	}
+
+	bool create_pipeline(const FG::FrameGraph& fg, bool sdf_font, OUT FG::GPipelineID& pipeline)
+	{
+		using namespace std::string_literals;
+
+		FG::GraphicsPipelineDesc desc;
+
+		desc.AddShader(FG::EShader::Vertex, FG::EShaderLangFormat::VKSL_100, "main", R"#(
+			#version 450 core
+			layout(location = 0) in vec2 aPos;
+			layout(location = 1) in vec2 aUV;
+			layout(location = 2) in vec4 aColor;
+
+			//layout(push_constant) uniform uPushConstant {
+			layout(set=0, binding=1, std140) uniform uPushConstant {
+				vec2 uScale;
+				vec2 uTranslate;
+			} pc;
+
+			out gl_PerVertex{
+				vec4 gl_Position;
+			};
+
+			layout(location = 0) out struct{
+				vec4 Color;
+				vec2 UV;
+			} Out;
+
+			void main()
+			{
+				Out.Color = aColor;
+				Out.UV = aUV;
+				gl_Position = vec4(aPos*pc.uScale+pc.uTranslate, 0, 1);
+			})#"s);
+
+		desc.AddShader(FG::EShader::Fragment, FG::EShaderLangFormat::VKSL_100, "main", R"#(
+			#version 450 core
+			layout(location = 0) out vec4 out_Color0;
+
+			layout(set=0, binding=0) uniform sampler2D sTexture;
+			)#"s + sample_texture_glsl(sdf_font) + R"#(
+			layout(location = 0) in struct{
+				vec4 Color;
+				vec2 UV;
+			} In;
+
+			void main()
+			{
+				out_Color0 = In.Color * sample_texture(In.UV.st);
+			})#"s);
+
+		pipeline = fg->CreatePipeline(desc);
+		CHECK_ERR(pipeline);
+		return true;
+	}
+
+	// Same as create_pipeline, but the per-draw clip rect and texture index come from a storage buffer indexed by the draw's
+	// firstInstance, and clipping is done with discard instead of a scissor, so the whole UI is a single indirect draw.
+	bool create_indirect_pipeline(const FG::FrameGraph& fg, bool sdf_font, OUT FG::GPipelineID& pipeline)
+	{
+		using namespace std::string_literals;
+
+		FG::GraphicsPipelineDesc desc;
+
+		desc.AddShader(FG::EShader::Vertex, FG::EShaderLangFormat::VKSL_100, "main", R"#(
+			#version 450 core
+			layout(location = 0) in vec2 aPos;
+			layout(location = 1) in vec2 aUV;
+			layout(location = 2) in vec4 aColor;
+
+			layout(set=0, binding=1, std140) uniform uPushConstant {
+				vec2 uScale;
+				vec2 uTranslate;
+			} pc;
+
+			struct DrawInfo {
+				vec4 clipRect;
+				uint textureIndex;
+				uint padding0;
+				uint padding1;
+				uint padding2;
+			};
+
+			layout(set=0, binding=2, std430) readonly buffer DrawData {
+				DrawInfo draws[];
+			};
+
+			out gl_PerVertex{
+				vec4 gl_Position;
+			};
+
+			layout(location = 0) out struct{
+				vec4 Color;
+				vec2 UV;
+			} Out;
+
+			layout(location = 2) flat out vec4 ClipRect;
+
+			void main()
+			{
+				Out.Color = aColor;
+				Out.UV = aUV;
+				ClipRect = draws[gl_InstanceIndex].clipRect;
+				gl_Position = vec4(aPos*pc.uScale+pc.uTranslate, 0, 1);
+			})#"s);
+
+		desc.AddShader(FG::EShader::Fragment, FG::EShaderLangFormat::VKSL_100, "main", R"#(
+			#version 450 core
+			layout(location = 0) out vec4 out_Color0;
+
+			layout(set=0, binding=0) uniform sampler2D sTexture;
+			)#"s + sample_texture_glsl(sdf_font) + R"#(
+			layout(location = 0) in struct{
+				vec4 Color;
+				vec2 UV;
+			} In;
+
+			layout(location = 2) flat in vec4 ClipRect;
+
+			void main()
+			{
+				if (any(lessThan(gl_FragCoord.xy, ClipRect.xy)) || any(greaterThanEqual(gl_FragCoord.xy, ClipRect.zw)))
+					discard;
+
+				out_Color0 = In.Color * sample_texture(In.UV.st);
+			})#"s);
+
+		pipeline = fg->CreatePipeline(desc);
+		CHECK_ERR(pipeline);
+		return true;
+	}
+
+	bool create_sdf_pipelines(const FG::FrameGraph& fg)
+	{
+		if (!m_sdf_pipeline)
+		{
+			CHECK_ERR(create_pipeline(fg, true, OUT m_sdf_pipeline));
+		}
+		if (m_supports_indirect_draw && !m_indirect_sdf_pipeline)
+		{
+			CHECK_ERR(create_indirect_pipeline(fg, true, OUT m_indirect_sdf_pipeline));
+		}
+		return true;
+	}
+
+	// Returns false if the frame can't be drawn indirectly (user callbacks must run between draws in submission order).
+	bool build_indirect_draws(imgui_renderer_window& pw, const ImDrawData* draw_data)
+	{
+		pw.m_indirect_cmds.clear();
+		pw.m_indirect_draws.clear();
+
+		const ImVec2 clip_off	= draw_data->DisplayPos;
+		const ImVec2 clip_scale = draw_data->FramebufferScale;
+
+		FG::uint global_idx_offset = 0;
+		FG::uint global_vtx_offset = 0;
+
+		for (int i = 0; i < draw_data->CmdListsCount; ++i)
+		{
+			const ImDrawList& cmd_list = *draw_data->CmdLists[i];
+
+			for (int j = 0; j < cmd_list.CmdBuffer.Size; ++j)
+			{
+				const ImDrawCmd& cmd = cmd_list.CmdBuffer[j];
+
+				if (cmd.UserCallback)
+				{
+					if (cmd.UserCallback == ImDrawCallback_ResetRenderState)
+					{
+						continue;
+					}
+					return false;
+				}
+
+				if (cmd.ElemCount == 0)
+				{
+					continue;
+				}
+
+				VkDrawIndexedIndirectCommand draw_cmd;
+				draw_cmd.indexCount	   = cmd.ElemCount;
+				draw_cmd.instanceCount = 1;
+				draw_cmd.firstIndex	   = cmd.IdxOffset + global_idx_offset;
+				draw_cmd.vertexOffset  = int32_t(cmd.VtxOffset + global_vtx_offset);
+				draw_cmd.firstInstance = uint32_t(pw.m_indirect_cmds.size()); // selects the DrawInfo entry in the shader
+
+				imgui_renderer_window::indirect_draw_data draw_info = {};
+
+				draw_info.m_clip_rect[0]  = (cmd.ClipRect.x - clip_off.x) * clip_scale.x;
+				draw_info.m_clip_rect[1]  = (cmd.ClipRect.y - clip_off.y) * clip_scale.y;
+				draw_info.m_clip_rect[2]  = (cmd.ClipRect.z - clip_off.x) * clip_scale.x;
+				draw_info.m_clip_rect[3]  = (cmd.ClipRect.w - clip_off.y) * clip_scale.y;
+				draw_info.m_texture_index = 0; // only the font atlas is bound today, see the per-draw path
+
+				if (pw.m_clip_to_damage)
+				{
+					draw_info.m_clip_rect[0] = std::max(draw_info.m_clip_rect[0], float(pw.m_damage_rect.left));
+					draw_info.m_clip_rect[1] = std::max(draw_info.m_clip_rect[1], float(pw.m_damage_rect.top));
+					draw_info.m_clip_rect[2] = std::min(draw_info.m_clip_rect[2], float(pw.m_damage_rect.right));
+					draw_info.m_clip_rect[3] = std::min(draw_info.m_clip_rect[3], float(pw.m_damage_rect.bottom));
+
+					if (draw_info.m_clip_rect[0] >= draw_info.m_clip_rect[2] || draw_info.m_clip_rect[1] >= draw_info.m_clip_rect[3])
+					{
+						continue;
+					}
+				}
+
+				pw.m_indirect_cmds.push_back(draw_cmd);
+				pw.m_indirect_draws.push_back(draw_info);
+			}
+
+			global_idx_offset += cmd_list.IdxBuffer.Size;
+			global_vtx_offset += cmd_list.VtxBuffer.Size;
+		}
+		return !pw.m_indirect_cmds.empty();
+	}
+
+	ND_ FG::Task upload_indirect_draws(imgui_renderer_window& pw, const FG::CommandBuffer& cmdbuf)
+	{
+		imgui_renderer_window::frame_resources& frame = pw.frame();
+
+		FG::FrameGraph fg			  = cmdbuf->GetFrameGraph();
+		FG::BytesU	   indirect_size  = bytes_of(pw.m_indirect_cmds);
+		FG::BytesU	   draw_data_size = bytes_of(pw.m_indirect_draws);
+
+		if (not frame.m_indirect_buffer or indirect_size > frame.m_indirect_buf_size)
+		{
+			fg->ReleaseResource(INOUT frame.m_indirect_buffer);
+
+			frame.m_indirect_buf_size = indirect_size;
+			frame.m_indirect_buffer	  = fg->CreateBuffer(FG::BufferDesc{indirect_size, FG::EBufferUsage::TransferDst | FG::EBufferUsage::Indirect}, FG::Default, "UI.IndirectBuffer");
+		}
+
+		if (not frame.m_draw_data_buffer or draw_data_size > frame.m_draw_data_buf_size)
+		{
+			fg->ReleaseResource(INOUT frame.m_draw_data_buffer);
+
+			frame.m_draw_data_buf_size = draw_data_size;
+			frame.m_draw_data_buffer   = fg->CreateBuffer(FG::BufferDesc{draw_data_size, FG::EBufferUsage::TransferDst | FG::EBufferUsage::Storage}, FG::Default, "UI.DrawDataBuffer");
+		}
+
+		pw.m_frame_upload_bytes += size_t(indirect_size + draw_data_size);
+
+		FG::Task last_task = pw.add_task(cmdbuf, FG::UpdateBuffer{}.SetBuffer(frame.m_indirect_buffer).AddData(pw.m_indirect_cmds.data(), pw.m_indirect_cmds.size()));
+		return pw.add_task(
+			cmdbuf, FG::UpdateBuffer{}.SetBuffer(frame.m_draw_data_buffer).AddData(pw.m_indirect_draws.data(), pw.m_indirect_draws.size()).DependsOn(last_task));
+	}
+
+	bool init_pipeline(imgui_renderer_window& pw, const FG::FrameGraph& fg)
+	{
+		for (auto& frame : pw.m_frames)
+		{
+			CHECK_ERR(fg->InitPipelineResources(m_pipeline, FG::DescriptorSetID("0"), OUT frame.m_resources));
+		}
+		return true;
+	}
+
+	bool create_sampler(const FG::FrameGraph& fg)
+	{
+		FG::SamplerDesc desc;
+		desc.SetFilter(FG::EFilter::Linear, FG::EFilter::Linear, FG::EMipmapFilter::Linear);
+		desc.SetAddressMode(FG::EAddressMode::Repeat);
+		desc.SetLodRange(-1000.0f, 1000.0f);
+
+		m_font_sampler = fg->CreateSampler(desc);
+		CHECK_ERR(m_font_sampler);
+		return true;
+	}
+
+	ND_ FG::Task create_font_texture(ImGuiContext* _context, const FG::CommandBuffer& cmdbuf)
+	{
+		if (m_font_texture)
+		{
+			return null;
+		}
+
+		IMGUI_APP_FW_TRACE_SCOPE("font atlas upload");
+		const auto start = std::chrono::steady_clock::now();
+
+		if (m_sdf_fonts)
+		{
+			CHECK_ERR(create_sdf_pipelines(cmdbuf->GetFrameGraph()));
+		}
+
+		uint8_t* pixels;
+		int		 width, height;
+
+		const size_t bytes_per_pixel = get_font_pixels(_context, OUT pixels, OUT width, OUT height);
+		const size_t upload_size	 = size_t(width) * size_t(height) * bytes_per_pixel;
+
+		m_font_texture = cmdbuf->GetFrameGraph()->CreateImage(
+			FG::ImageDesc{}
+				.SetDimension({FG::uint(width), FG::uint(height)})
+				.SetFormat(m_alpha_font_atlas ? FG::EPixelFormat::R8_UNorm : FG::EPixelFormat::RGBA8_UNorm)
+				.SetUsage(FG::EImageUsage::Sampled | FG::EImageUsage::TransferDst),
+			FG::Default, "UI.FontTexture");
+		CHECK_ERR(m_font_texture);
+
+		m_font_view = FG::ImageViewDesc{};
+		if (m_alpha_font_atlas)
+		{
+			using FG::operator""_swizzle;
+			m_font_view.SetSwizzle("111R"_swizzle);
+		}
+
+		FG::Task task = cmdbuf->AddTask(FG::UpdateImage{}.SetImage(m_font_texture).SetData(pixels, upload_size, FG::uint2{FG::int2{width, height}}));
+		m_counters.add_uploads(1, upload_size);
+
+		// UpdateImage copies into staging memory when the task is added, so this covers the CPU side of the upload
+		++m_font_generation;
+		m_font_atlas_bytes = upload_size;
+		m_font_upload_ms   = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+		return task;
+	}
+
+	// Uploads the atlas areas the glyph cache rasterized into since the last upload, one UpdateImage per page.
+	ND_ FG::Task upload_glyphs(glyph_cache& cache, const FG::CommandBuffer& cmdbuf)
+	{
+		IMGUI_APP_FW_TRACE_SCOPE("glyph upload");
+
+		FG::Task last = nullptr;
+
+		cache.flush_dirty([&](int x, int y, int width, int height, const uint8_t* data, size_t size) {
+			FG::UpdateImage update;
+			update.SetImage(m_font_texture.Get(), FG::int2{x, y}).SetData(data, size, FG::uint2{FG::int2{width, height}});
+			if (last)
+			{
+				update.DependsOn(last);
+			}
+			last = cmdbuf->AddTask(update);
+			m_counters.add_uploads(1, size);
+		});
+
+		if (last)
+		{
+			++m_font_generation;
+		}
+		return last;
+	}
+
+	FG::RawImageID font_texture(const imgui_renderer_window& pw) const
+	{
+		return pw.m_font_texture ? pw.m_font_texture : m_font_texture.Get();
+	}
+
+	// Texels per UI unit a viewport samples the atlas at: its framebuffer scale, times the monitor DPI when ImGui scales fonts by it.
+	static int dpi_scale(const ImGuiViewport* viewport, const ImDrawData* draw_data, ImGuiConfigFlags flags)
+	{
+		float scale = draw_data->FramebufferScale.x;
+		if (flags & ImGuiConfigFlags_DpiEnableScaleFonts)
+		{
+			scale *= viewport->DpiScale;
+		}
+		return std::clamp(int(scale + 0.5f), 1, k_max_dpi_scale);
+	}
+
+	bool wants_dpi_atlas(int scale) const
+	{
+		return scale > 1 && m_dpi_font_atlases && !m_sdf_fonts; // distance fields already scale
+	}
+
+	// ImGui thread, after Render(): a viewport draws at this scale, so its atlas is kept or queued for creation. The render
+	// thread may be recording, so this doesn't add to m_dpi_atlases.
+	void use_dpi_scale(int scale)
+	{
+		if (!wants_dpi_atlas(scale))
+		{
+			return;
+		}
+
+		for (dpi_atlas& atlas : m_dpi_atlases)
+		{
+			if (atlas.m_scale == scale)
+			{
+				atlas.m_last_used = std::chrono::steady_clock::now();
+				return;
+			}
+		}
+		if (std::find(m_new_dpi_scales.begin(), m_new_dpi_scales.end(), scale) == m_new_dpi_scales.end())
+		{
+			m_new_dpi_scales.push_back(scale);
+		}
+	}
+
+	// Read while recording, safe because m_dpi_atlases only changes in update_dpi_atlases() with the render thread idle.
+	FG::RawImageID dpi_font_texture(int scale) const
+	{
+		if (!wants_dpi_atlas(scale))
+		{
+			return {};
+		}
+
+		for (const dpi_atlas& atlas : m_dpi_atlases)
+		{
+			if (atlas.m_scale == scale && atlas.m_generation == m_font_generation)
+			{
+				return atlas.m_texture.Get();
+			}
+		}
+		return {};
+	}
+
+	bool is_expired(const dpi_atlas& atlas, std::chrono::steady_clock::time_point now) const
+	{
+		return !wants_dpi_atlas(atlas.m_scale) || std::chrono::duration<double>(now - atlas.m_last_used).count() > m_dpi_atlas_timeout;
+	}
+
+	// True when an atlas has to be built, rebuilt after the base atlas changed, or evicted.
+	bool dpi_atlases_pending() const
+	{
+		if (!m_new_dpi_scales.empty())
+		{
+			return true;
+		}
+
+		const auto now = std::chrono::steady_clock::now();
+		for (const dpi_atlas& atlas : m_dpi_atlases)
+		{
+			if (atlas.m_generation != m_font_generation || is_expired(atlas, now))
+			{
+				return true;
+			}
+		}
+		return false;
+	}
+
+	// Called with the render thread idle, after the base atlas upload it depends on.
+	ND_ FG::Task update_dpi_atlases(ImGuiContext* _context, const FG::CommandBuffer& cmdbuf, FG::Task dependency)
+	{
+		const FG::FrameGraph& fg  = cmdbuf->GetFrameGraph();
+		const auto			  now = std::chrono::steady_clock::now();
+
+		for (auto it = m_dpi_atlases.begin(); it != m_dpi_atlases.end();)
+		{
+			if (is_expired(*it, now))
+			{
+				fg->ReleaseResource(INOUT it->m_texture);
+				it = m_dpi_atlases.erase(it);
+			}
+			else
+			{
+				++it;
+			}
+		}
+
+		for (int scale : m_new_dpi_scales)
+		{
+			if (wants_dpi_atlas(scale))
+			{
+				m_dpi_atlases.push_back({scale, {}, 0, 0, now});
+			}
+		}
+		m_new_dpi_scales.clear();
+
+		FG::Task last = dependency;
+		for (dpi_atlas& atlas : m_dpi_atlases)
+		{
+			if (atlas.m_generation == m_font_generation)
+			{
+				continue;
+			}
+			fg->ReleaseResource(INOUT atlas.m_texture);
+			atlas.m_generation = m_font_generation;
+			atlas.m_bytes	   = 0;
+
+			uint8_t* pixels;
+			int		 width, height;
+
+			const size_t bytes_per_pixel = get_font_pixels(_context, OUT pixels, OUT width, OUT height);
+
+			int scale = atlas.m_scale;
+			while (scale > 1 && std::max(width, height) * scale > k_max_dpi_atlas_size)
+			{
+				--scale;
+			}
+			if (scale == 1)
+			{
+				continue; // dpi_font_texture() finds no texture, the viewport keeps the base atlas
+			}
+
+			IMGUI_APP_FW_TRACE_SCOPE("DPI atlas build and upload");
+			m_dpi_builder.build(_context->IO.Fonts, pixels, bytes_per_pixel, scale, m_workers, OUT m_dpi_pixels);
+
+			atlas.m_texture = fg->CreateImage(
+				FG::ImageDesc{}
+					.SetDimension({FG::uint(width * scale), FG::uint(height * scale)})
+					.SetFormat(m_alpha_font_atlas ? FG::EPixelFormat::R8_UNorm : FG::EPixelFormat::RGBA8_UNorm)
+					.SetUsage(FG::EImageUsage::Sampled | FG::EImageUsage::TransferDst),
+				FG::Default, "UI.FontTexture.DPI");
+			CHECK_ERR(atlas.m_texture);
+			atlas.m_bytes = m_dpi_pixels.size();
+
+			FG::UpdateImage update;
+			update.SetImage(atlas.m_texture).SetData(m_dpi_pixels.data(), m_dpi_pixels.size(), FG::uint2{FG::int2{width * scale, height * scale}});
+			if (last)
+			{
+				update.DependsOn(last);
+			}
+			last = cmdbuf->AddTask(update);
+			m_counters.add_uploads(1, m_dpi_pixels.size());
+		}
+
+		// staging already holds the copy, scaled atlases are large enough not to keep around
+		m_dpi_pixels.clear();
+		m_dpi_pixels.shrink_to_fit();
+
+		m_dpi_atlas_bytes = 0;
+		for (const dpi_atlas& atlas : m_dpi_atlases)
+		{
+			m_dpi_atlas_bytes += atlas.m_bytes;
+		}
+		return last;
+	}
+
+	// Runs get_font_pixels on a thread, nothing else may touch the atlas until finish_font_build() returns.
+	void start_font_build(ImGuiContext* _context)
+	{
+		m_font_builder = std::thread([this, _context]() {
+			IMGUI_APP_FW_TRACE_THREAD("font builder");
+
+			uint8_t* pixels;
+			int		 width, height;
+			get_font_pixels(_context, OUT pixels, OUT width, OUT height);
+		});
+	}
+
+	void finish_font_build(ImGuiContext* _context)
+	{
+		if (m_font_builder.joinable())
+		{
+			m_font_builder.join();
+			return;
+		}
+
+		uint8_t* pixels;
+		int		 width, height;
+		get_font_pixels(_context, OUT pixels, OUT width, OUT height);
+	}
+
+	// Rasterizes the alpha8 atlas, or restores it from m_atlas_cache when the fonts and their configs match the last run.
+	void build_atlas(ImFontAtlas* atlas)
+	{
+		IMGUI_APP_FW_TRACE_SCOPE("font atlas build");
+		const auto start = std::chrono::steady_clock::now();
+
+		if (atlas->ConfigData.empty())
+		{
+			atlas->AddFontDefault(); // what Build() would do, the cache key needs the config
+		}
+		if (m_sdf_fonts)
+		{
+			m_sdf.prepare(atlas);
+		}
+
+		const uint64_t key = font_atlas_cache::key(atlas);
+		if (!m_atlas_cache.load(atlas, key))
+		{
+			uint8_t* pixels;
+			int		 width, height;
+			atlas->GetTexDataAsAlpha8(OUT & pixels, OUT & width, OUT & height);
+			m_atlas_cache.save(atlas, key);
+		}
+		m_font_build_ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+	}
+
+	// Builds the atlas if needed, returns the bytes per pixel of the data it returns.
+	size_t get_font_pixels(ImGuiContext* _context, OUT uint8_t*& pixels, OUT int& width, OUT int& height)
+	{
+		ImFontAtlas* atlas = _context->IO.Fonts;
+		if (!atlas->TexPixelsAlpha8 && !atlas->TexPixelsRGBA32)
+		{
+			build_atlas(atlas);
+		}
+
+		if (m_sdf_fonts)
+		{
+			// RGBA32 data is expanded from the alpha8 pixels, so converting those first covers both formats
+			atlas->GetTexDataAsAlpha8(OUT & pixels, OUT & width, OUT & height);
+			m_sdf.convert(atlas, pixels, m_workers);
+		}
+
+		if (m_alpha_font_atlas)
+		{
+			atlas->GetTexDataAsAlpha8(OUT & pixels, OUT & width, OUT & height);
+			return 1;
+		}
+
+		atlas->GetTexDataAsRGBA32(OUT & pixels, OUT & width, OUT & height);
+		return 4;
+	}
+
+	// With 32 bit ImDrawIdx, a frame whose draw lists all have at most 64k vertices only holds indices that fit in 16 bits
+	// (indices are relative to their draw list), so it can be uploaded as UShort for half the index bandwidth.
+	bool should_repack_indices(const ImDrawData* draw_data) const
+	{
+		if constexpr (sizeof(index_t) == sizeof(uint16_t))
+		{
+			return false;
+		}
+		else
+		{
+			if (!m_repack_indices)
+			{
+				return false;
+			}
+
+			for (int i = 0; i < draw_data->CmdListsCount; ++i)
+			{
+				if (draw_data->CmdLists[i]->VtxBuffer.Size > 0x10000)
+				{
+					return false;
+				}
+			}
+			return true;
+		}
+	}
+
+	static void repack_indices(imgui_renderer_window& pw, const ImDrawData* draw_data)
+	{
+		pw.m_repacked_indices.resize(size_t(draw_data->TotalIdxCount));
+
+		uint16_t* dst = pw.m_repacked_indices.data();
+		for (int i = 0; i < draw_data->CmdListsCount; ++i)
+		{
+			const ImDrawList& cmd_list = *draw_data->CmdLists[i];
+			const index_t*	  src	   = cmd_list.IdxBuffer.Data;
+
+			// plain narrowing loop, vectorized by the compiler
+			for (int j = 0, count = cmd_list.IdxBuffer.Size; j < count; ++j)
+			{
+				dst[j] = uint16_t(src[j]);
+			}
+			dst += cmd_list.IdxBuffer.Size;
+		}
+	}
+
+	bool pack_vertices(imgui_renderer_window& pw, const ImDrawData* draw_data)
+	{
+		if (!m_compact_vertices)
+		{
+			return false;
+		}
+
+		pw.m_packed_vertices.resize(size_t(draw_data->TotalVtxCount));
+
+		compact_vert* dst = pw.m_packed_vertices.data();
+		for (int i = 0; i < draw_data->CmdListsCount; ++i)
+		{
+			const ImDrawList& cmd_list = *draw_data->CmdLists[i];
+			if (!compact_vertex_packer::pack(cmd_list.VtxBuffer.Data, size_t(cmd_list.VtxBuffer.Size), dst, draw_data->DisplayPos))
+			{
+				// something lies outside the fixed point range (huge off-screen geometry, tiled UVs), use full precision this frame
+				return false;
+			}
+			dst += cmd_list.VtxBuffer.Size;
+		}
+		return true;
+	}
+
+	ND_ FG::Task create_buffers(imgui_renderer_window& pw, ImDrawData* draw_data, ImGuiContext* _context, const FG::CommandBuffer& cmdbuf)
+	{
+		IMGUI_APP_FW_PROFILE_SCOPE(create_buffers);
+
+		imgui_renderer_window::frame_resources& frame = pw.frame();
+
+		const bool repack = should_repack_indices(draw_data);
+		const bool packed = pack_vertices(pw, draw_data);
+
+		pw.m_index_type		  = repack ? FG::EIndex::UShort : k_index_type;
+		pw.m_compact_vertices = packed;
+
+		FG::FrameGraph fg		   = cmdbuf->GetFrameGraph();
+		FG::BytesU	   vertex_size = draw_data->TotalVtxCount * (packed ? FG::SizeOf<compact_vert> : FG::SizeOf<ImDrawVert>);
+		FG::BytesU	   index_size  = draw_data->TotalIdxCount * (repack ? FG::SizeOf<uint16_t> : FG::SizeOf<index_t>);
+
+		pw.m_frame_upload_bytes += size_t(vertex_size + index_size);
+
+		if (repack)
+		{
+			repack_indices(pw, draw_data);
+		}
+
+		if (not frame.m_vertex_buffer or vertex_size > frame.m_vertex_buf_size)
+		{
+			fg->ReleaseResource(INOUT frame.m_vertex_buffer);
+
+			frame.m_vertex_buf_size = vertex_size;
+			frame.m_vertex_buffer	= fg->CreateBuffer(FG::BufferDesc{vertex_size, FG::EBufferUsage::TransferDst | FG::EBufferUsage::Vertex}, FG::Default, "UI.VertexBuffer");
+		}
+
+		if (not frame.m_index_buffer or index_size > frame.m_index_buf_size)
+		{
+			fg->ReleaseResource(INOUT frame.m_index_buffer);
+
+			frame.m_index_buf_size = index_size;
+			frame.m_index_buffer   = fg->CreateBuffer(FG::BufferDesc{index_size, FG::EBufferUsage::TransferDst | FG::EBufferUsage::Index}, FG::Default, "UI.IndexBuffer");
+		}
+
+		if (m_parallel_upload && m_workers && m_workers->is_running() && size_t(vertex_size + index_size) >= k_parallel_upload_threshold)
+		{
+			return create_buffers_parallel(pw, draw_data, cmdbuf, vertex_size, index_size, repack, packed);
+		}
+
+		FG::BytesU vb_offset;
+		FG::BytesU ib_offset;
+
+		FG::Task last_task;
+
+		for (int i = 0; i < draw_data->CmdListsCount; ++i)
+		{
+			const ImDrawList& cmd_list = *draw_data->CmdLists[i];
+
+			if (!packed)
+			{
+				last_task = pw.add_task(cmdbuf, FG::UpdateBuffer{}.SetBuffer(frame.m_vertex_buffer).AddData(cmd_list.VtxBuffer.Data, cmd_list.VtxBuffer.Size, vb_offset).DependsOn(last_task));
+				vb_offset += cmd_list.VtxBuffer.Size * FG::SizeOf<ImDrawVert>;
+			}
+
+			if (!repack)
+			{
+				last_task = pw.add_task(cmdbuf, FG::UpdateBuffer{}.SetBuffer(frame.m_index_buffer).AddData(cmd_list.IdxBuffer.Data, cmd_list.IdxBuffer.Size, ib_offset).DependsOn(last_task));
+				ib_offset += cmd_list.IdxBuffer.Size * FG::SizeOf<index_t>;
+			}
+		}
+
+		if (packed)
+		{
+			last_task = pw.add_task(
+				cmdbuf, FG::UpdateBuffer{}.SetBuffer(frame.m_vertex_buffer).AddData(pw.m_packed_vertices.data(), pw.m_packed_vertices.size()).DependsOn(last_task));
+			vb_offset += bytes_of(pw.m_packed_vertices);
+		}
+
+		if (repack)
+		{
+			last_task = pw.add_task(
+				cmdbuf, FG::UpdateBuffer{}.SetBuffer(frame.m_index_buffer).AddData(pw.m_repacked_indices.data(), pw.m_repacked_indices.size()).DependsOn(last_task));
+			ib_offset += bytes_of(pw.m_repacked_indices);
+		}
+
+		ASSERT(vertex_size == vb_offset);
+		ASSERT(index_size == ib_offset);
+		return last_task;
+	}
+
+	// Draw list offsets are a prefix sum of their sizes, so every list's copy into staging memory is independent.
+	// Staging space is allocated up front on this thread, the memcpys into the mapped memory are spread over the worker pool,
+	// and the GPU copies staging -> vertex/index buffer with one CopyBuffer per staging chunk.
+	ND_ FG::Task create_buffers_parallel(
+		imgui_renderer_window& pw, ImDrawData* draw_data, const FG::CommandBuffer& cmdbuf, FG::BytesU vertex_size, FG::BytesU index_size, bool repacked_indices,
+		bool packed_vertices)
+	{
+		imgui_renderer_window::frame_resources& frame = pw.frame();
+
+		pw.m_upload_copies.clear();
+
+		FG::Task last_task;
+
+		auto stage = [&](const FG::BufferID& dst_buffer, size_t total_size, auto get_span) -> bool {
+			int	   list_index  = 0;
+			size_t list_offset = 0;
+
+			for (size_t dst_offset = 0; dst_offset < total_size;)
+			{
+				const size_t chunk_size = std::min(k_staging_chunk_size, total_size - dst_offset);
+
+				FG::RawBufferID staging_id;
+				FG::BytesU		staging_offset;
+				void*			mapped = nullptr;
+				CHECK_ERR(cmdbuf->AllocBuffer(FG::BytesU{chunk_size}, FG::BytesU{16}, OUT staging_id, OUT staging_offset, OUT mapped));
+
+				last_task = pw.add_task(cmdbuf, FG::CopyBuffer{}.From(staging_id).To(dst_buffer).AddRegion(staging_offset, FG::BytesU{dst_offset}, FG::BytesU{chunk_size}).DependsOn(last_task));
+
+				// walk the source spans that fall into this chunk
+				for (size_t chunk_pos = 0; chunk_pos < chunk_size;)
+				{
+					const auto [src, src_size] = get_span(list_index);
+					const size_t copy_size	   = std::min({src_size - list_offset, chunk_size - chunk_pos, k_copy_granularity});
+
+					if (copy_size > 0)
+					{
+						pw.m_upload_copies.push_back({static_cast<uint8_t*>(mapped) + chunk_pos, src + list_offset, copy_size});
+					}
+
+					chunk_pos += copy_size;
+					list_offset += copy_size;
+					if (list_offset == src_size)
+					{
+						++list_index;
+						list_offset = 0;
+					}
+				}
+
+				dst_offset += chunk_size;
+			}
+			return true;
+		};
+
+		if (packed_vertices)
+		{
+			CHECK_ERR(stage(frame.m_vertex_buffer, size_t(vertex_size), [&pw](int) {
+				return std::make_pair(reinterpret_cast<const uint8_t*>(pw.m_packed_vertices.data()), pw.m_packed_vertices.size() * sizeof(compact_vert));
+			}));
+		}
+		else
+		{
+			CHECK_ERR(stage(frame.m_vertex_buffer, size_t(vertex_size), [draw_data](int i) {
+				const ImDrawList& list = *draw_data->CmdLists[i];
+				return std::make_pair(reinterpret_cast<const uint8_t*>(list.VtxBuffer.Data), size_t(list.VtxBuffer.Size) * sizeof(ImDrawVert));
+			}));
+		}
+
+		if (repacked_indices)
+		{
+			CHECK_ERR(stage(frame.m_index_buffer, size_t(index_size), [&pw](int) {
+				return std::make_pair(reinterpret_cast<const uint8_t*>(pw.m_repacked_indices.data()), pw.m_repacked_indices.size() * sizeof(uint16_t));
+			}));
+		}
+		else
+		{
+			CHECK_ERR(stage(frame.m_index_buffer, size_t(index_size), [draw_data](int i) {
+				const ImDrawList& list = *draw_data->CmdLists[i];
+				return std::make_pair(reinterpret_cast<const uint8_t*>(list.IdxBuffer.Data), size_t(list.IdxBuffer.Size) * sizeof(index_t));
+			}));
+		}
+
+		// the copy tasks read the staging memory only once the command buffer is executed, which happens after this returns
+		m_workers->parallel_for(pw.m_upload_copies.size(), [&pw](size_t i) {
+			const auto& copy = pw.m_upload_copies[i];
+			std::memcpy(copy.m_dst, copy.m_src, copy.m_size);
+		});
+
+		return last_task;
+	}
+
+	ND_ FG::Task update_uniform_buffer(imgui_renderer_window& pw, ImDrawData* draw_data, ImGuiContext* _context, const FG::CommandBuffer& cmdbuf)
+	{
+		imgui_renderer_window::frame_resources& frame = pw.frame();
+
+		if (not frame.m_uniform_buffer)
+		{
+			frame.m_uniform_buffer =
+				cmdbuf->GetFrameGraph()->CreateBuffer(FG::BufferDesc{(FG::BytesU)16, FG::EBufferUsage::Uniform | FG::EBufferUsage::TransferDst}, FG::Default, "UI.UniformBuffer");
+			CHECK_ERR(frame.m_uniform_buffer);
+		}
+
+		FG::float4 pc_data;
+		// scale:
+		pc_data[0] = 2.0f / (draw_data->DisplaySize.x * draw_data->FramebufferScale.x);
+		pc_data[1] = 2.0f / (draw_data->DisplaySize.y * draw_data->FramebufferScale.y);
+		// transform:
+		pc_data[2] = -1.0f - draw_data->DisplayPos.x * pc_data[0];
+		pc_data[3] = -1.0f - draw_data->DisplayPos.y * pc_data[1];
+
+		if (pw.m_compact_vertices)
+		{
+			// compact positions are already relative to DisplayPos and in quarter pixels
+			pc_data[0] /= compact_vertex_packer::k_pos_scale;
+			pc_data[1] /= compact_vertex_packer::k_pos_scale;
+			pc_data[2] = -1.0f;
+			pc_data[3] = -1.0f;
+		}
+
+		pw.m_frame_upload_bytes += sizeof(pc_data);
+		return pw.add_task(cmdbuf, FG::UpdateBuffer{}.SetBuffer(frame.m_uniform_buffer).AddData(&pc_data, 1));
+	}
+};
+
+using imgui_renderer = imgui_renderer_t<ImDrawIdx>;
+
+struct platform_window_data
+{
+	GLFWwindow* m_window;
+	bool		m_window_owned;
+	int			m_ignore_window_pos_event_frame;
+	int			m_ignore_window_size_event_frame;
+
+	platform_window_data()
+	{
+		m_window						 = NULL;
+		m_window_owned					 = false;
+		m_ignore_window_size_event_frame = m_ignore_window_pos_event_frame = -1;
+	}
+
+	~platform_window_data()
+	{
+		IM_ASSERT(m_window == NULL);
+	}
+};
+
+struct platform_device_factory : public FGC::IVulkanSurface
+{
+	GLFWwindow* m_window;
+
+	platform_device_factory(GLFWwindow* wnd) : m_window{wnd} {}
+
+	virtual ~platform_device_factory() {}
+
+	FGC::ArrayView<const char*> GetRequiredExtensions() const override
+	{
+		uint32_t	 required_extension_count = 0;
+		const char** required_extensions	  = glfwGetRequiredInstanceExtensions(&required_extension_count);
+
+		return FGC::ArrayView<const char*>{required_extensions, required_extension_count};
+	}
+
+	SurfaceVk_t Create(InstanceVk_t inst) const override
+	{
+		VkSurfaceKHR surf = VK_NULL_HANDLE;
+		glfwCreateWindowSurface(FGC::BitCast<VkInstance>(inst), m_window, nullptr, &surf);
+		return FGC::BitCast<SurfaceVk_t>(surf);
+	}
+};
+
+struct platform_renderer_data
+{
+	// An opted-in window rendered once into its own image and composited as a single quad until its draw list changes.
+	struct window_layer
+	{
+		ImGuiID				  m_window_id = 0;
+		FG::ImageID			  m_image;
+		FG::uint2			  m_size;
+		uint64_t			  m_hash	  = 0;
+		uint64_t			  m_last_used = 0;
+		imgui_renderer_window m_renderer_window;
+		ImDrawList			  m_quad; // replaces the window's draw list in the viewport's draw data
+
+		window_layer(ImDrawListSharedData* shared, std::pmr::memory_resource* arena) : m_renderer_window{arena}, m_quad{shared} {}
+
+		uint64_t bytes() const
+		{
+			return uint64_t(m_size.x) * m_size.y * 4;
+		}
+	};
+
+	struct swapped_list
+	{
+		int			m_index;
+		ImDrawList* m_original;
+	};
+
+	bool m_is_primary{false};
+
+	// transients of one record_frame() call, per viewport so parallel recording needs no locking. Declared before the
+	// renderer windows whose vectors allocate from it.
+	frame_arena m_arena;
+
+	FGC::VulkanDevice2::window_specific m_window_specific;
+	FG::SwapchainID						m_swapchain_id;
+	imgui_renderer_window				m_imgui_window{&m_arena};
+	uint64_t							m_last_draw_hash{0};
+	bool								m_last_draw_hashable{false};
+	std::atomic<bool>					m_needs_redraw{true};
+	damage_tracker						m_damage;
+	FG::ImageID							m_retained_image; // partial redraw target, copied to the swapchain every frame
+	FG::uint2							m_retained_size;
+
+	std::vector<std::unique_ptr<window_layer>> m_layers;
+	std::vector<swapped_list>				   m_swapped_lists; // lists replaced by apply_layers() this frame
+	uint64_t								   m_layer_frame{0};
+
+	gpu_timer m_gpu_timer;
+
+	struct shared_data
+	{
+		FGC::UniquePtr<FGC::VulkanDevice2Initializer> m_device;
+		FG::FrameGraph								  m_frame_graph;
+		imgui_renderer								  m_imgui_renderer;
+		FG::Array<FG::Task>							  m_shared_tasks;
+		bool										  m_skip_unchanged_frames{false};
+		imgui_app_fw_interface::frame_statistics	  m_statistics;
+		std::mutex									  m_statistics_mutex; // statistics are updated by the render thread when it runs
+		worker_pool									  m_workers;
+		bool										  m_parallel_viewports{false};
+		bool										  m_partial_redraw{false};
+		std::vector<ImGuiID>						  m_layer_windows; // written between frames only
+		uint64_t									  m_layer_budget{64ull << 20};
+		std::atomic<uint64_t>						  m_layer_bytes{0};
+		std::atomic<uint64_t>						  m_layer_count{0};
+		std::atomic<uint64_t>						  m_layer_renders{0};
+		std::atomic<uint64_t>						  m_layer_evictions{0};
+		bool										  m_render_thread{false}; // recording runs on a snapshot, off the ImGui thread
+		std::atomic<uint64_t>						  m_arena_high_water{0};  // max over all viewports
+		std::atomic<uint64_t>						  m_arena_overflows{0};
+		glyph_cache									  m_glyph_cache; // ImGui thread only
+		bool										  m_gpu_profiling{false};
+		bool										  m_gpu_timestamps{false}; // a viewport created a query pool, under m_statistics_mutex
+		timing_window								  m_gpu_pass_times;		   // under m_statistics_mutex
+		timing_window								  m_gpu_callback_times;
+		double										  m_gpu_last_pass_ms = 0.0; // newest UI pass read back, for the HUD graph
+	};
+
+	static inline shared_data m_shared;
+
+	// frames a layer survives without its window being drawn, so briefly hidden windows don't lose their layer
+	static constexpr uint64_t k_layer_grace_frames = 120;
+
+	// partial redraw copies the retained image into the swapchain image
+	static constexpr FG::ImageUsageVk_t k_swapchain_usage = FG::ImageUsageVk_t(VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_TRANSFER_DST_BIT);
+
+	void init(ImGuiContext* imgui_context, ImGuiViewport* viewport, bool primary)
+	{
+		auto window			 = (GLFWwindow*)viewport->PlatformHandle;
+		auto surface_factory = FGC::UniquePtr<FGC::IVulkanSurface>(new platform_device_factory(window));
+
+		if (primary)
+		{
+			// the atlas is rasterized or loaded while the instance, device and framegraph are created, init_shared waits for it
+			m_shared.m_glyph_cache.reserve(imgui_context->IO.Fonts);
+			m_shared.m_imgui_renderer.start_font_build(imgui_context);
+
+			auto new_device			 = std::make_unique<FGC::VulkanDevice2Initializer>();
+			auto required_extensions = surface_factory->GetRequiredExtensions();
+			new_device->CreateInstance("app_name", "engine_name", new_device->GetRecomendedInstanceLayers(), required_extensions);
+
+			m_window_specific.CreateInstance(surface_factory, new_device->GetVkInstance());
+
+			new_device->ChooseHighPerformanceDevice();
+			new_device->CreateLogicalDevice({{VK_QUEUE_GRAPHICS_BIT | VK_QUEUE_SPARSE_BINDING_BIT}, {VK_QUEUE_COMPUTE_BIT}, {VK_QUEUE_TRANSFER_BIT}}, true, true, FGC::Default);
+
+			FG::VulkanDeviceInfo vulkan_info;
+			{
+				vulkan_info.instance	   = FGC::BitCast<FG::InstanceVk_t>(new_device->GetVkInstance());
+				vulkan_info.physicalDevice = FGC::BitCast<FG::PhysicalDeviceVk_t>(new_device->GetVkPhysicalDevice());
+				vulkan_info.device		   = FGC::BitCast<FG::DeviceVk_t>(new_device->GetVkDevice());
+
+				vulkan_info.maxStagingBufferMemory = ~FGC::BytesU(0);
+				vulkan_info.stagingBufferSize	   = FGC::BytesU{8 * 1024 * 1024};
+
+				for (auto& q : new_device->GetVkQueues())
+				{
+					FG::VulkanDeviceInfo::QueueInfo qi;
+					qi.handle	   = FGC::BitCast<FG::QueueVk_t>(q.handle);
+					qi.familyFlags = FGC::BitCast<FG::QueueFlagsVk_t>(q.familyFlags);
+					qi.familyIndex = q.familyIndex;
+					qi.priority	   = q.priority;
+					qi.debugName   = q.debugName;
+
+					vulkan_info.queues.push_back(qi);
+				}
+			}
+			m_shared.m_frame_graph = FG::IFrameGraph::CreateFrameGraph(vulkan_info);
+
+			{
+				auto compiler = FG::MakeShared<FG::VPipelineCompiler>(vulkan_info.instance, vulkan_info.physicalDevice, vulkan_info.device);
+				compiler->SetCompilationFlags(FG::EShaderCompilationFlags::Quiet);
+				m_shared.m_frame_graph->AddPipelineCompiler(compiler);
+			}
+
+			// one indirect draw with drawCount > 1 needs multiDrawIndirect, and a non-zero firstInstance drawIndirectFirstInstance
+			const VkPhysicalDeviceFeatures& features		   = new_device->GetProperties().features;
+			m_shared.m_imgui_renderer.m_supports_indirect_draw = features.multiDrawIndirect == VK_TRUE && features.drawIndirectFirstInstance == VK_TRUE;
+			m_shared.m_imgui_renderer.init_shared(imgui_context, m_shared.m_frame_graph);
+			m_shared.m_imgui_renderer.m_workers = &m_shared.m_workers;
+			m_shared.m_device = std::move(new_device);
+		}
+		else
+		{
+			m_window_specific.CreateInstance(surface_factory, m_shared.m_device->GetVkInstance());
+		}
+
+		m_shared.m_imgui_renderer.init(m_imgui_window, imgui_context, m_shared.m_frame_graph);
+
+		FG::VulkanSwapchainCreateInfo swapchain_info;
+		{
+			swapchain_info.surface		 = FGC::BitCast<FG::SurfaceVk_t>(m_window_specific.GetVkSurface());
+			swapchain_info.surfaceSize.x = uint32_t(viewport->Size.x);
+			swapchain_info.surfaceSize.y = uint32_t(viewport->Size.y);
+			swapchain_info.requiredUsage = k_swapchain_usage;
+		}
+		m_swapchain_id			   = m_shared.m_frame_graph->CreateSwapchain(swapchain_info);
+		m_is_primary			   = primary;
+		viewport->RendererUserData = this;
+	}
+
+	void handle_resize(ImGuiViewport* viewport)
+	{
+		auto window = (GLFWwindow*)viewport->PlatformHandle;
+		int	 new_width, new_height;
+		glfwGetWindowSize(window, &new_width, &new_height);
+
+		if (new_width > 0 && new_height > 0)
+		{
+			FG::VulkanSwapchainCreateInfo swapchain_info;
+			swapchain_info.surface		 = FG::BitCast<FG::SurfaceVk_t>(m_window_specific.GetVkSurface());
+			swapchain_info.surfaceSize.x = new_width;
+			swapchain_info.surfaceSize.y = new_height;
+			swapchain_info.requiredUsage = k_swapchain_usage;
+
+			m_shared.m_frame_graph->WaitIdle();
+
+			m_swapchain_id = m_shared.m_frame_graph->CreateSwapchain(swapchain_info, m_swapchain_id.Release());
+			m_needs_redraw = true;
+			m_damage.invalidate();
+			m_shared.m_imgui_renderer.m_counters.m_swapchain_recreations.fetch_add(1, std::memory_order_relaxed);
+		}
+	}
+
+	void destroy(ImGuiViewport* viewport)
+	{
+		if (m_gpu_timer.m_pool != VK_NULL_HANDLE)
+		{
+			// the framegraph doesn't track the pool, so the frames that wrote it have to finish first
+			m_shared.m_device->vkDeviceWaitIdle(m_shared.m_device->GetVkDevice());
+			m_gpu_timer.destroy();
+		}
+
+		m_shared.m_frame_graph->ReleaseResource(m_swapchain_id);
+		m_shared.m_frame_graph->ReleaseResource(m_retained_image);
+		while (!m_layers.empty())
+		{
+			release_layer(m_layers.size() - 1);
+		}
+		m_shared.m_imgui_renderer.destroy(m_imgui_window, m_shared.m_frame_graph);
+
+		if (m_is_primary)
+		{
+			m_shared.m_workers.stop();
+			m_shared.m_imgui_renderer.destroy_shared(m_shared.m_frame_graph);
+			m_shared.m_frame_graph->Deinitialize();
+			m_shared.m_frame_graph = nullptr;
+
+			m_shared.m_device->DestroyLogicalDevice();
+			m_shared.m_device->DestroyInstance();
+			m_shared.m_device.reset();
+		}
+	}
+
+	static void end_frame()
+	{
+		{
+			IMGUI_APP_FW_PROFILE_SCOPE(flush);
+			CHECK_ERR(m_shared.m_frame_graph->Flush());
+		}
+	}
+
+	static bool has_assets_to_load()
+	{
+		return !m_shared.m_imgui_renderer.m_font_texture || m_shared.m_glyph_cache.has_dirty() || m_shared.m_imgui_renderer.dpi_atlases_pending();
+	}
+
+	// ImGui thread, after Render(): keeps the DPI atlases of the scales visible viewports draw at alive.
+	static void use_font_scales(const ImGuiPlatformIO& platform_io, ImGuiConfigFlags flags)
+	{
+		for (const ImGuiViewport* viewport : platform_io.Viewports)
+		{
+			if (viewport->RendererUserData && viewport->DrawData && viewport->DrawData->TotalVtxCount > 0 && !(viewport->Flags & ImGuiViewportFlags_Minimized))
+			{
+				m_shared.m_imgui_renderer.use_dpi_scale(imgui_renderer::dpi_scale(viewport, viewport->DrawData, flags));
+			}
+		}
+	}
+
+	FG::Task load_assets(ImGuiContext* ctx)
+	{
+		if (m_is_primary && has_assets_to_load())
+		{
+			FG::CommandBuffer cmdbuf = m_shared.m_frame_graph->Begin(FG::CommandBufferDesc{FG::EQueueType::Graphics});
+			m_shared.m_shared_tasks.clear();
+			FG::Task new_task;
+			if (!m_shared.m_imgui_renderer.m_font_texture)
+			{
+				// the full upload already holds every cached glyph
+				new_task = m_shared.m_imgui_renderer.create_font_texture(ctx, cmdbuf);
+				m_shared.m_glyph_cache.clear_dirty();
+			}
+			else
+			{
+				new_task = m_shared.m_imgui_renderer.upload_glyphs(m_shared.m_glyph_cache, cmdbuf);
+			}
+			new_task = m_shared.m_imgui_renderer.update_dpi_atlases(ctx, cmdbuf, new_task);
+
+			IMGUI_APP_FW_PROFILE_SCOPE(execute);
+			m_shared.m_frame_graph->Execute(cmdbuf);
+			return new_task;
+		}
+
+		return nullptr;
+	}
+
+	bool is_unchanged(ImDrawData* draw_data, FG::Task dependent_task, bool needs_redraw)
+	{
+		uint64_t   hash		 = 0;
+		const bool hashable	 = draw_data_hasher::hash(draw_data, OUT hash);
+		const bool unchanged = hashable && m_last_draw_hashable && !needs_redraw && !dependent_task && hash == m_last_draw_hash;
+
+		m_last_draw_hash	 = hash;
+		m_last_draw_hashable = hashable;
+		return unchanged;
+	}
+
+	// Returns false if the viewport was skipped because nothing changed since the last presented frame.
+	static void count_viewport(bool rendered)
+	{
+		std::lock_guard<std::mutex> lock(m_shared.m_statistics_mutex);
+		++(rendered ? m_shared.m_statistics.viewports_rendered : m_shared.m_statistics.viewports_skipped);
+	}
+
+	// Moves this viewport's finished timestamps into the shared windows and starts timing the frame being recorded.
+	bool begin_gpu_timing(const FG::CommandBuffer& cmdbuf)
+	{
+		if (!m_shared.m_gpu_profiling)
+		{
+			return false;
+		}
+
+		std::lock_guard<std::mutex> lock(m_shared.m_statistics_mutex);
+		const bool					timed = m_gpu_timer.begin_frame(*m_shared.m_device, cmdbuf, [](bool callback, double ms, int64_t gpu_start_ns, int64_t record_ns) {
+			(callback ? m_shared.m_gpu_callback_times : m_shared.m_gpu_pass_times).add(ms);
+			if (!callback)
+			{
+				m_shared.m_gpu_last_pass_ms = ms;
+			}
+#if IMGUI_APP_FW_CPU_PROFILER
+			trace_recorder::add_gpu(callback ? "user callback" : "UI pass", gpu_start_ns, int64_t(ms * 1e6), record_ns);
+#endif
+		});
+		m_shared.m_gpu_timestamps |= timed;
+		return timed;
+	}
+
+	bool render_frame(ImGuiContext* ctx, ImGuiViewport* viewport, ImDrawData* draw_data, FG::Task dependent_task)
+	{
+		FG::CommandBuffer cmdbuf;
+		const bool		  rendered = record_frame(ctx, viewport, draw_data, dependent_task, OUT cmdbuf);
+
+		if (cmdbuf)
+		{
+			IMGUI_APP_FW_PROFILE_SCOPE(execute);
+			CHECK_ERR(m_shared.m_frame_graph->Execute(cmdbuf));
+		}
+
+		count_viewport(rendered);
+		return rendered;
+	}
+
+	// Records the viewport into a new command buffer without submitting it. Touches only this viewport's state and
+	// read-only shared state, so different viewports can be recorded concurrently. Returns false if the viewport was skipped.
+	bool record_frame(ImGuiContext* ctx, ImGuiViewport* viewport, ImDrawData* draw_data, FG::Task dependent_task, OUT FG::CommandBuffer& result)
+	{
+		const bool recorded = record_commands(ctx, viewport, draw_data, dependent_task, OUT result);
+
+		// the recorded tasks hold copies of the uploaded data, so the transients are dead once recording is done
+		release_arena();
+		return recorded;
+	}
+
+	bool record_commands(ImGuiContext* ctx, ImGuiViewport* viewport, ImDrawData* draw_data, FG::Task dependent_task, OUT FG::CommandBuffer& result)
+	{
+		// set when the OS lost the window contents, a refresh arriving while this frame records sets it again for the next one
+		const bool needs_redraw = m_needs_redraw.exchange(false);
+
+		if (m_shared.m_skip_unchanged_frames && is_unchanged(draw_data, dependent_task, needs_redraw))
+		{
+			// The swapchain still holds the last presented image, so upload, render pass and present can all be skipped.
+			return false;
+		}
+
+		if (needs_redraw || !m_shared.m_partial_redraw || draw_data->TotalVtxCount == 0)
+		{
+			// the window needs a full redraw, or the retained image isn't updated by this frame and the next tracked frame has
+			// nothing to diff against
+			m_damage.invalidate();
+		}
+
+		FG::RectI  damage;
+		const bool tracked = m_shared.m_partial_redraw && m_damage.update(draw_data, OUT damage) && !dependent_task;
+
+		if (tracked && (damage.left >= damage.right || damage.top >= damage.bottom))
+		{
+			// nothing changed, the swapchain keeps showing the last presented image
+			return false;
+		}
+
+		if (draw_data->TotalVtxCount > 0)
+		{
+			FG::CommandBuffer cmdbuf = m_shared.m_frame_graph->Begin(FG::CommandBufferDesc{FG::EQueueType::Graphics});
+			CHECK_ERR(cmdbuf);
+
+			m_imgui_window.m_timer = begin_gpu_timing(cmdbuf) ? &m_gpu_timer : nullptr;
+
+			{
+				std::pmr::vector<FG::Task> dep_tasks{&m_arena};
+				if (dependent_task)
+				{
+					dep_tasks.push_back(dependent_task);
+				}
+
+				m_imgui_window.m_font_texture = m_shared.m_imgui_renderer.dpi_font_texture(imgui_renderer::dpi_scale(viewport, draw_data, ctx->IO.ConfigFlags));
+				apply_layers(ctx, viewport, draw_data, cmdbuf, INOUT dep_tasks);
+
+				FG::RawImageID	  image = cmdbuf->GetSwapchainImage(m_swapchain_id);
+				FG::RGBA32f		  _clearColor{0.45f, 0.55f, 0.60f, 1.00f};
+				FG::LogicalPassID pass_id;
+				FG::int2		  fb_size;
+
+				if (m_shared.m_partial_redraw)
+				{
+					// The UI is drawn into a retained image so untouched pixels survive between frames, then copied to whichever
+					// swapchain image was acquired. The render area limits both the clear and the store to the damaged rect.
+					const bool reusable = prepare_retained_image(image);
+					const bool partial	= tracked && reusable;
+
+					fb_size = FG::int2(m_retained_size);
+					if (partial)
+					{
+						damage.left	  = std::max(damage.left, 0);
+						damage.top	  = std::max(damage.top, 0);
+						damage.right  = std::min(damage.right, fb_size.x);
+						damage.bottom = std::min(damage.bottom, fb_size.y);
+					}
+					else
+					{
+						damage = FG::RectI{0, 0, fb_size.x, fb_size.y};
+					}
+
+					m_imgui_window.m_clip_to_damage = partial;
+					m_imgui_window.m_damage_rect	= damage;
+
+					pass_id = cmdbuf->CreateRenderPass(FG::RenderPassDesc{damage}
+														   .AddViewport(FG::float2{draw_data->DisplaySize.x, draw_data->DisplaySize.y})
+														   .AddTarget(FG::RenderTargetID::Color_0, m_retained_image, _clearColor, FG::EAttachmentStoreOp::Store));
+				}
+				else
+				{
+					m_imgui_window.m_clip_to_damage = false;
+
+					pass_id = cmdbuf->CreateRenderPass(FG::RenderPassDesc{FG::int2{FG::float2{draw_data->DisplaySize.x, draw_data->DisplaySize.y}}}
+														   .AddViewport(FG::float2{draw_data->DisplaySize.x, draw_data->DisplaySize.y})
+														   .AddTarget(FG::RenderTargetID::Color_0, image, _clearColor, FG::EAttachmentStoreOp::Store));
+				}
+
+				FG::Task draw_ui = m_shared.m_imgui_renderer.draw(
+					m_imgui_window, draw_data, ctx, cmdbuf, pass_id, FG::ArrayView<FG::Task>{dep_tasks.data(), dep_tasks.size()},
+					[&cmdbuf, &pass_id](const ImDrawList& cmd_list, const ImDrawCmd& cmd, FG::Task timestamp) -> FG::Task {
+						return imgui_app_fw_interface::mutable_userdata(&cmdbuf, pass_id, timestamp).call(cmd_list, cmd);
+					});
+
+				if (m_shared.m_partial_redraw)
+				{
+					FG::Task copy = cmdbuf->AddTask(FG::CopyImage{}
+														.From(m_retained_image)
+														.To(image)
+														.AddRegion({}, FG::int2{}, {}, FG::int2{}, FG::uint2(fb_size))
+														.DependsOn(draw_ui));
+					FG::Unused(copy);
+				}
+				else
+				{
+					FG::Unused(draw_ui);
+				}
+
+				restore_layers(draw_data);
+			}
+
+			result = std::move(cmdbuf);
+		}
+		return true;
+	}
+
+	// Publishes this frame's arena use and resets it. The arena may reallocate its block, so every vector holding arena memory
+	// is released first.
+	void release_arena()
+	{
+		m_imgui_window.release_transients();
+		for (const auto& layer : m_layers)
+		{
+			layer->m_renderer_window.release_transients();
+		}
+
+		const uint64_t overflows = m_arena.m_overflows;
+		m_arena.reset();
+		m_arena.m_overflows = 0;
+
+		m_shared.m_arena_overflows += overflows;
+
+		uint64_t high_water = m_shared.m_arena_high_water.load(std::memory_order_relaxed);
+		while (m_arena.m_high_water > high_water && !m_shared.m_arena_high_water.compare_exchange_weak(high_water, m_arena.m_high_water))
+		{
+		}
+	}
+
+	// Swaps the draw lists of opted-in windows for a textured quad of their layer, re-rendering layers whose content, size or
+	// scale changed. The layer renders are added to deps. restore_layers() must be called once the frame is recorded.
+	void apply_layers(ImGuiContext* ctx, ImGuiViewport* viewport, ImDrawData* draw_data, const FG::CommandBuffer& cmdbuf, INOUT std::pmr::vector<FG::Task>& deps)
+	{
+		m_imgui_window.m_layer_textures.clear();
+		m_swapped_lists.clear();
+		++m_layer_frame;
+
+		if (m_shared.m_render_thread)
+		{
+			// layers read live ImGuiWindow state, which the main thread is already changing for the next frame
+			return;
+		}
+
+		for (ImGuiID id : m_shared.m_layer_windows)
+		{
+			ImGuiWindow* window = static_cast<ImGuiWindow*>(ctx->WindowsById.GetVoidPtr(id));
+			if (!window || window->Viewport != viewport || !window->Active || window->Hidden)
+			{
+				continue;
+			}
+
+			int index = -1;
+			for (int i = 0; i < draw_data->CmdListsCount; ++i)
+			{
+				if (draw_data->CmdLists[i] == window->DrawList)
+				{
+					index = i;
+					break;
+				}
+			}
+
+			const ImVec2	scale = draw_data->FramebufferScale;
+			const FG::uint2 size{FG::uint(std::ceil(window->Size.x * scale.x)), FG::uint(std::ceil(window->Size.y * scale.y))};
+			if (index < 0 || size.x == 0 || size.y == 0)
+			{
+				continue;
+			}
+
+			// position and scale are part of the hash, the layer is rendered in viewport-independent pixels starting at the window origin.
+			// So are the atlas texture and its generation: glyph uploads, atlas rebuilds and DPI atlas swaps change what text samples.
+			const float placement[4] = {window->Pos.x, window->Pos.y, scale.x, scale.y};
+			uint64_t	seed		 = draw_data_hasher::hash_memory(placement, sizeof(placement), id);
+			seed					 = draw_data_hasher::hash_memory(&m_imgui_window.m_font_texture, sizeof(m_imgui_window.m_font_texture), seed);
+			seed					 = draw_data_hasher::hash_memory(&m_shared.m_imgui_renderer.m_font_generation, sizeof(uint64_t), seed);
+
+			uint64_t hash = 0;
+			if (!draw_data_hasher::hash_list(*window->DrawList, seed, OUT hash))
+			{
+				continue;
+			}
+
+			window_layer* layer = find_or_create_layer(ctx, id, size);
+			if (!layer)
+			{
+				continue;
+			}
+
+			if (layer->m_hash != hash)
+			{
+				deps.push_back(render_layer(ctx, *layer, window, draw_data, cmdbuf));
+				layer->m_hash = hash;
+				++m_shared.m_layer_renders;
+			}
+			layer->m_last_used = m_layer_frame;
+
+			// one quad covering the layer, white so the shader returns the premultiplied texel unchanged
+			const ImVec2 p0 = window->Pos;
+			const ImVec2 p1{window->Pos.x + size.x / scale.x, window->Pos.y + size.y / scale.y};
+
+			ImDrawList& quad = layer->m_quad;
+			quad.VtxBuffer.resize(4);
+			quad.IdxBuffer.resize(6);
+			quad.CmdBuffer.resize(1);
+			quad.VtxBuffer[0] = ImDrawVert{ImVec2{p0.x, p0.y}, ImVec2{0.0f, 0.0f}, IM_COL32_WHITE};
+			quad.VtxBuffer[1] = ImDrawVert{ImVec2{p1.x, p0.y}, ImVec2{1.0f, 0.0f}, IM_COL32_WHITE};
+			quad.VtxBuffer[2] = ImDrawVert{ImVec2{p1.x, p1.y}, ImVec2{1.0f, 1.0f}, IM_COL32_WHITE};
+			quad.VtxBuffer[3] = ImDrawVert{ImVec2{p0.x, p1.y}, ImVec2{0.0f, 1.0f}, IM_COL32_WHITE};
+
+			const ImDrawIdx indices[6] = {0, 1, 2, 0, 2, 3};
+			std::memcpy(quad.IdxBuffer.Data, indices, sizeof(indices));
+
+			ImDrawCmd cmd;
+			cmd.ClipRect	  = ImVec4{p0.x, p0.y, p1.x, p1.y};
+			cmd.TextureId	  = ImTextureID(layer);
+			cmd.ElemCount	  = 6;
+			quad.CmdBuffer[0] = cmd;
+
+			ImDrawList* original = draw_data->CmdLists[index];
+
+			draw_data->TotalVtxCount += quad.VtxBuffer.Size - original->VtxBuffer.Size;
+			draw_data->TotalIdxCount += quad.IdxBuffer.Size - original->IdxBuffer.Size;
+
+			draw_data->CmdLists[index] = &quad;
+
+			m_swapped_lists.push_back({index, original});
+			m_imgui_window.m_layer_textures.emplace_back(ImTextureID(layer), layer->m_image.Get());
+		}
+
+		// drop layers of windows that were closed, moved to another viewport or opted out
+		for (size_t i = m_layers.size(); i-- > 0;)
+		{
+			if (m_layers[i]->m_last_used + k_layer_grace_frames < m_layer_frame)
+			{
+				release_layer(i);
+				++m_shared.m_layer_evictions;
+			}
+		}
+	}
+
+	void restore_layers(ImDrawData* draw_data)
+	{
+		for (const swapped_list& swapped : m_swapped_lists)
+		{
+			const ImDrawList* quad = draw_data->CmdLists[swapped.m_index];
+
+			draw_data->TotalVtxCount += swapped.m_original->VtxBuffer.Size - quad->VtxBuffer.Size;
+			draw_data->TotalIdxCount += swapped.m_original->IdxBuffer.Size - quad->IdxBuffer.Size;
+
+			draw_data->CmdLists[swapped.m_index] = swapped.m_original;
+		}
+		m_swapped_lists.clear();
+	}
+
+	// Returns nullptr if the layer doesn't fit the memory budget even after evicting this viewport's unused layers.
+	window_layer* find_or_create_layer(ImGuiContext* ctx, ImGuiID id, const FG::uint2& size)
+	{
+		size_t index = 0;
+		while (index < m_layers.size() && m_layers[index]->m_window_id != id)
+		{
+			++index;
+		}
+
+		if (index < m_layers.size())
+		{
+			if (m_layers[index]->m_size == size)
+			{
+				return m_layers[index].get();
+			}
+			release_layer(index);
+		}
+
+		const uint64_t bytes = uint64_t(size.x) * size.y * 4;
+		while (!reserve_layer_bytes(bytes))
+		{
+			// least recently used layer that isn't part of this frame
+			size_t victim = m_layers.size();
+			for (size_t i = 0; i < m_layers.size(); ++i)
+			{
+				if (m_layers[i]->m_last_used < m_layer_frame && (victim == m_layers.size() || m_layers[i]->m_last_used < m_layers[victim]->m_last_used))
+				{
+					victim = i;
+				}
+			}
+
+			if (victim == m_layers.size())
+			{
+				return nullptr;
+			}
+			release_layer(victim);
+			++m_shared.m_layer_evictions;
+		}
+
+		FG::ImageID image = m_shared.m_frame_graph->CreateImage(
+			FG::ImageDesc{}.SetDimension(size).SetFormat(FG::EPixelFormat::RGBA8_UNorm).SetUsage(FG::EImageUsage::ColorAttachment | FG::EImageUsage::Sampled), FG::Default,
+			"UI.WindowLayer");
+		if (!image)
+		{
+			m_shared.m_layer_bytes -= bytes;
+			return nullptr;
+		}
+
+		auto layer		   = std::make_unique<window_layer>(&ctx->DrawListSharedData, &m_arena);
+		layer->m_window_id = id;
+		layer->m_size	   = size;
+		layer->m_image	   = std::move(image);
+		if (!m_shared.m_imgui_renderer.init(layer->m_renderer_window, ctx, m_shared.m_frame_graph))
+		{
+			m_shared.m_frame_graph->ReleaseResource(layer->m_image);
+			m_shared.m_layer_bytes -= bytes;
+			return nullptr;
+		}
+
+		++m_shared.m_layer_count;
+
+		m_layers.push_back(std::move(layer));
+		return m_layers.back().get();
+	}
+
+	// Adds bytes to the layer total shared by all viewports if it stays within the budget. Viewports recording in parallel reserve
+	// concurrently, a separate check and add would let them overshoot together.
+	static bool reserve_layer_bytes(uint64_t bytes)
+	{
+		uint64_t used = m_shared.m_layer_bytes.load();
+		do
+		{
+			if (used + bytes > m_shared.m_layer_budget)
+			{
+				return false;
+			}
+		} while (!m_shared.m_layer_bytes.compare_exchange_weak(used, used + bytes));
+		return true;
+	}
+
+	void release_layer(size_t index)
+	{
+		window_layer& layer = *m_layers[index];
+
+		m_shared.m_layer_bytes -= layer.bytes();
+		--m_shared.m_layer_count;
+		m_shared.m_frame_graph->ReleaseResource(layer.m_image);
+		m_shared.m_imgui_renderer.destroy(layer.m_renderer_window, m_shared.m_frame_graph);
+
+		m_layers.erase(m_layers.begin() + index);
+	}
+
+	FG::Task render_layer(ImGuiContext* ctx, window_layer& layer, ImGuiWindow* window, const ImDrawData* draw_data, const FG::CommandBuffer& cmdbuf)
+	{
+		ImDrawList* list = window->DrawList;
+
+		ImDrawData layer_data;
+		layer_data.Valid			= true;
+		layer_data.CmdLists			= &list;
+		layer_data.CmdListsCount	= 1;
+		layer_data.TotalVtxCount	= list->VtxBuffer.Size;
+		layer_data.TotalIdxCount	= list->IdxBuffer.Size;
+		layer_data.DisplayPos		= window->Pos;
+		layer_data.DisplaySize		= ImVec2{layer.m_size.x / draw_data->FramebufferScale.x, layer.m_size.y / draw_data->FramebufferScale.y};
+		layer_data.FramebufferScale = draw_data->FramebufferScale;
+
+		layer.m_renderer_window.m_premultiplied_output = true;
+		layer.m_renderer_window.m_font_texture		   = m_imgui_window.m_font_texture;
+
+		FG::LogicalPassID pass_id = cmdbuf->CreateRenderPass(FG::RenderPassDesc{FG::int2(layer.m_size)}
+																 .AddViewport(FG::float2{layer_data.DisplaySize.x, layer_data.DisplaySize.y})
+																 .AddTarget(FG::RenderTargetID::Color_0, layer.m_image, FG::RGBA32f{0.0f}, FG::EAttachmentStoreOp::Store));
+
+		// hash_list() rejects windows with user callbacks, so there is nothing to forward
+		return m_shared.m_imgui_renderer.draw(layer.m_renderer_window, &layer_data, ctx, cmdbuf, pass_id, {}, [](const ImDrawList&, const ImDrawCmd&, FG::Task) -> FG::Task {
+			return nullptr;
+		});
+	}
+
+	// (Re)creates the retained image to match the swapchain. Returns false if its content can't be reused this frame.
+	bool prepare_retained_image(FG::RawImageID swapchain_image)
+	{
+		const FG::ImageDesc& swapchain_desc = m_shared.m_frame_graph->GetDescription(swapchain_image);
+		const FG::uint2		 size{swapchain_desc.dimension.x, swapchain_desc.dimension.y};
+
+		if (m_retained_image && m_retained_size == size)
+		{
+			return true;
+		}
+
+		m_shared.m_frame_graph->ReleaseResource(m_retained_image);
+
+		m_retained_size	 = size;
+		m_retained_image = m_shared.m_frame_graph->CreateImage(FG::ImageDesc{}
+																   .SetDimension(size)
+																   .SetFormat(swapchain_desc.format)
+																   .SetUsage(FG::EImageUsage::ColorAttachment | FG::EImageUsage::TransferSrc),
+															   FG::Default, "UI.RetainedImage");
+		return false;
+	}
+};
+
+// Deep copy of every viewport's ImDrawData, recorded by the render thread while the main thread builds the next frame.
+// Draw lists are pooled and their buffers only grow, so capturing a steady state frame doesn't allocate.
+struct draw_data_snapshot
+{
+	struct viewport_copy
+	{
+		ImGuiViewport* m_viewport;
+		ImDrawData	   m_draw_data;
+		size_t		   m_first_list;
+	};
+
+	std::vector<viewport_copy>				 m_viewports;
+	std::vector<std::unique_ptr<ImDrawList>> m_list_pool;
+	std::vector<ImDrawList*>				 m_lists;
+	FG::Task								 m_pending_task;
+
+	template <typename T>
+	static void copy_vector(ImVector<T>& dst, const ImVector<T>& src)
+	{
+		// resize() keeps the capacity, ImVector::operator= frees and reallocates
+		dst.resize(src.Size);
+		if (src.Size > 0)
+		{
+			std::memcpy(dst.Data, src.Data, size_t(src.size_in_bytes()));
+		}
+	}
+
+	void begin(FG::Task pending_task)
+	{
+		m_viewports.clear();
+		m_lists.clear();
+		m_pending_task = pending_task;
+	}
+
+	void add(ImGuiViewport* viewport, const ImDrawData* draw_data)
+	{
+		viewport_copy copy;
+		copy.m_viewport	  = viewport;
+		copy.m_draw_data  = *draw_data;
+		copy.m_first_list = m_lists.size();
+
+		for (int i = 0; i < draw_data->CmdListsCount; ++i)
+		{
+			const ImDrawList& src = *draw_data->CmdLists[i];
+			if (m_lists.size() == m_list_pool.size())
+			{
+				m_list_pool.push_back(std::make_unique<ImDrawList>(src._Data));
+			}
+
+			ImDrawList& dst = *m_list_pool[m_lists.size()];
+			copy_vector(dst.CmdBuffer, src.CmdBuffer);
+			copy_vector(dst.IdxBuffer, src.IdxBuffer);
+			copy_vector(dst.VtxBuffer, src.VtxBuffer);
+			dst.Flags = src.Flags;
+
+			m_lists.push_back(&dst);
+		}
+		m_viewports.push_back(copy);
+	}
+
+	// CmdLists point into m_lists, which may have been reallocated while viewports were added
+	void end()
+	{
+		for (viewport_copy& copy : m_viewports)
+		{
+			copy.m_draw_data.CmdLists = m_lists.data() + copy.m_first_list;
+		}
+	}
+};
+
+// Single producer, single consumer triple buffer. The producer always has a free slot to write, the consumer always takes
+// the most recently published snapshot, and a snapshot the consumer didn't pick up in time is recycled instead of queued.
+struct snapshot_triple_buffer
+{
+	static constexpr uint32_t k_fresh = 4; // set in m_ready while it holds a snapshot the consumer hasn't taken
+
+	std::array<draw_data_snapshot, 3> m_slots;
+	uint32_t						  m_write = 0; // producer only
+	uint32_t						  m_read  = 1; // consumer only
+	std::atomic<uint32_t>			  m_ready{2};
+
+	draw_data_snapshot& write_slot()
+	{
+		return m_slots[m_write];
+	}
+
+	void publish()
+	{
+		m_write = m_ready.exchange(m_write | k_fresh, std::memory_order_acq_rel) & ~k_fresh;
+	}
+
+	bool has_fresh() const
+	{
+		return (m_ready.load(std::memory_order_acquire) & k_fresh) != 0;
+	}
+
+	// Returns nullptr if nothing was published since the last call.
+	draw_data_snapshot* acquire()
+	{
+		if (!has_fresh())
+		{
+			return nullptr;
+		}
+		m_read = m_ready.exchange(m_read, std::memory_order_acq_rel) & ~k_fresh;
+		return &m_slots[m_read];
+	}
+};
+
+struct render_thread
+{
+	using render_t = std::function<void(draw_data_snapshot&)>;
+
+	snapshot_triple_buffer	m_buffer;
+	render_t				m_render;
+	std::thread				m_thread;
+	std::mutex				m_mutex;
+	std::condition_variable m_wake;
+	std::condition_variable m_idle;
+	bool					m_busy = false;
+	bool					m_quit = false;
+
+	~render_thread()
+	{
+		stop();
+	}
+
+	bool is_running() const
+	{
+		return m_thread.joinable();
+	}
+
+	void start(render_t render)
+	{
+		stop();
+		m_render = std::move(render);
+		m_quit	 = false;
+		m_thread = std::thread([this]() { loop(); });
+	}
+
+	void stop()
+	{
+		if (!is_running())
+		{
+			return;
+		}
+
+		wait_idle();
+		{
+			std::lock_guard<std::mutex> lock(m_mutex);
+			m_quit = true;
+		}
+		m_wake.notify_one();
+		m_thread.join();
+	}
+
+	// Publishes m_buffer.write_slot() and wakes the render thread.
+	void submit()
+	{
+		m_buffer.publish();
+		{
+			// an empty critical section orders the publish against the render thread's wait predicate
+			std::lock_guard<std::mutex> lock(m_mutex);
+		}
+		m_wake.notify_one();
+	}
+
+	// Returns once every published snapshot has been rendered. The main thread must call this before it changes anything the
+	// render thread reads: creating, destroying or resizing viewports, the worker pool.
+	void wait_idle()
+	{
+		if (!is_running())
+		{
+			return;
+		}
+
+		std::unique_lock<std::mutex> lock(m_mutex);
+		m_idle.wait(lock, [this]() { return !m_busy && !m_buffer.has_fresh(); });
+	}
+
+	void loop()
+	{
+		IMGUI_APP_FW_TRACE_THREAD("render");
+
+		for (;;)
+		{
+			{
+				std::unique_lock<std::mutex> lock(m_mutex);
+				m_wake.wait(lock, [this]() { return m_quit || m_buffer.has_fresh(); });
+				if (m_quit)
+				{
+					return;
+				}
+				m_busy = true;
+			}
+
+			if (draw_data_snapshot* snapshot = m_buffer.acquire())
+			{
+				m_render(*snapshot);
+			}
+
+			{
+				std::lock_guard<std::mutex> lock(m_mutex);
+				m_busy = false;
+			}
+			m_idle.notify_all();
+		}
+	}
+};
+
+struct frame_pacer
+{
+	using clock_t	 = std::chrono::steady_clock;
+	using duration_t = std::chrono::duration<double>;
+
+	static constexpr size_t k_sample_count = 256;
+
+	imgui_app_fw_interface::frame_pacing_settings	m_settings;
+	imgui_app_fw_interface::frame_pacing_statistics m_statistics;
+
+	clock_t::time_point m_deadline;
+	clock_t::time_point m_last_frame;
+	bool				m_started = false;
+
+	// running estimate of how much longer than requested a sleep takes, sleeping stops this far ahead of the deadline and spins the rest
+	double m_sleep_estimate = 0.002;
+	double m_sleep_mean		= 0.001;
+	double m_sleep_m2		= 0.0;
+	double m_sleep_count	= 1.0;
+
+	std::array<double, k_sample_count> m_intervals = {};
+	size_t							   m_sample_pos = 0;
+	size_t							   m_sample_num = 0;
+
+#ifdef _WIN32
+	// Sleep() rounds up to the 15.6 ms scheduler tick, a high resolution waitable timer wakes within a fraction of a millisecond.
+	// Null on Windows before 10 1803, the sleep estimate then grows to the tick and the rest is spun.
+	HANDLE m_timer = CreateWaitableTimerExW(nullptr, nullptr, CREATE_WAITABLE_TIMER_HIGH_RESOLUTION, TIMER_ALL_ACCESS);
+
+	~frame_pacer()
+	{
+		if (m_timer)
+		{
+			CloseHandle(m_timer);
+		}
+	}
+#endif
+
+	void sleep_1ms()
+	{
+#ifdef _WIN32
+		if (m_timer)
+		{
+			LARGE_INTEGER due;
+			due.QuadPart = -10000; // relative, in 100 ns units
+			if (SetWaitableTimerEx(m_timer, &due, 0, nullptr, nullptr, nullptr, 0))
+			{
+				WaitForSingleObject(m_timer, INFINITE);
+				return;
+			}
+		}
+#endif
+		std::this_thread::sleep_for(std::chrono::milliseconds(1));
+	}
+
+	double frame_interval(double refresh_rate, bool focused, bool iconified) const
+	{
+		double interval = m_settings.target_fps > 0.0f ? 1.0 / m_settings.target_fps : 0.0;
+
+		if (m_settings.match_monitor_refresh && refresh_rate > 0.0)
+		{
+			// snap to a whole number of refresh periods so every frame lands on the same vblank phase
+			const double period = 1.0 / refresh_rate;
+			interval			= period * std::max(1.0, std::round(interval / period));
+		}
+
+		if (!focused && m_settings.unfocused_fps > 0.0f)
+		{
+			interval = std::max(interval, 1.0 / m_settings.unfocused_fps);
+		}
+
+		if (iconified && m_settings.iconified_fps > 0.0f)
+		{
+			interval = std::max(interval, 1.0 / m_settings.iconified_fps);
+		}
+		return interval;
+	}
+
+	void update_sleep_estimate(double observed)
+	{
+		// Welford's online mean/variance, the estimate is mean + one standard deviation
+		++m_sleep_count;
+		const double delta = observed - m_sleep_mean;
+		m_sleep_mean += delta / m_sleep_count;
+		m_sleep_m2 += delta * (observed - m_sleep_mean);
+		m_sleep_estimate = m_sleep_mean + std::sqrt(m_sleep_m2 / (m_sleep_count - 1.0));
+
+		// keep adapting to scheduler changes (power states, timer resolution)
+		if (m_sleep_count > 1000.0)
+		{
+			m_sleep_count = 1.0;
+			m_sleep_m2	  = 0.0;
+		}
+	}
+
+	void wait_until(clock_t::time_point deadline)
+	{
+		for (;;)
+		{
+			const double remaining = duration_t(deadline - clock_t::now()).count();
+			if (remaining <= m_sleep_estimate)
+			{
+				break;
+			}
+
+			const auto start = clock_t::now();
+			sleep_1ms();
+			update_sleep_estimate(duration_t(clock_t::now() - start).count());
+		}
+
+		while (clock_t::now() < deadline)
+		{
+			std::this_thread::yield();
+		}
+	}
+
+	void pace(double interval)
+	{
+		const auto now = clock_t::now();
+
+		if (interval > 0.0 && m_started)
+		{
+			m_deadline += std::chrono::duration_cast<clock_t::duration>(duration_t(interval));
+
+			if (m_deadline < now)
+			{
+				// missed the deadline, re-anchor instead of bursting frames to catch up
+				++m_statistics.missed_deadlines;
+				m_deadline = now;
+			}
+			else
 			{
-				auto compiler = FG::MakeShared<FG::VPipelineCompiler>(vulkan_info.instance, vulkan_info.physicalDevice, vulkan_info.device);
-				compiler->SetCompilationFlags(FG::EShaderCompilationFlags::Quiet);
-				m_shared.m_frame_graph->AddPipelineCompiler(compiler);
+				wait_until(m_deadline);
 			}
+		}
+		else
+		{
+			m_deadline = now;
+		}
 
-			m_shared.m_imgui_renderer.init_shared(imgui_context, m_shared.m_frame_graph);
-			m_shared.m_device = std::move(new_device);
+		const auto frame_start = clock_t::now();
+		if (m_started)
+		{
+			record(duration_t(frame_start - m_last_frame).count(), interval);
+		}
+
+		m_last_frame = frame_start;
+		m_started	 = true;
+	}
+
+	void record(double actual, double interval)
+	{
+		m_intervals[m_sample_pos] = actual;
+		m_sample_pos			  = (m_sample_pos + 1) % k_sample_count;
+		m_sample_num			  = std::min(m_sample_num + 1, k_sample_count);
+
+		double sum = 0.0, jitter_sum = 0.0, jitter_sq_sum = 0.0, jitter_max = 0.0;
+		for (size_t i = 0; i < m_sample_num; ++i)
+		{
+			const double jitter = interval > 0.0 ? std::abs(m_intervals[i] - interval) : 0.0;
+			sum += m_intervals[i];
+			jitter_sum += jitter;
+			jitter_sq_sum += jitter * jitter;
+			jitter_max = std::max(jitter_max, jitter);
+		}
+
+		const double n			 = double(m_sample_num);
+		const double jitter_mean = jitter_sum / n;
+
+		++m_statistics.frames;
+		m_statistics.target_interval_ms = interval * 1000.0;
+		m_statistics.mean_interval_ms	= sum / n * 1000.0;
+		m_statistics.jitter_mean_ms		= jitter_mean * 1000.0;
+		m_statistics.jitter_stddev_ms	= std::sqrt(std::max(0.0, jitter_sq_sum / n - jitter_mean * jitter_mean)) * 1000.0;
+		m_statistics.jitter_max_ms		= jitter_max * 1000.0;
+	}
+
+	void reset()
+	{
+		m_started	 = false;
+		m_sample_num = 0;
+		m_sample_pos = 0;
+	}
+};
+
+// Overlay the framework draws over the main viewport. Everything it shows comes from counters that exist anyway, the frame
+// time history lives in fixed arrays and each graph is one polyline.
+struct performance_hud
+{
+	static constexpr int   k_history   = 120;			  // frames in the graphs
+	static constexpr float k_budget_ms = 1000.0f / 60.0f; // guide line
+
+	bool m_visible	  = false;
+	int	 m_toggle_key = 0; // none until set_performance_hud() binds one
+
+	std::array<float, k_history>  m_cpu_ms{};
+	std::array<float, k_history>  m_gpu_ms{};
+	std::array<ImVec2, k_history> m_points;
+	int							  m_next  = 0;
+	int							  m_count = 0;
+
+	frame_counters::snapshot m_last;				 // previous frame
+	uint64_t				 m_allocations		= 0; // ImGui heap allocations during the previous frame
+	uint64_t				 m_allocation_total = 0;
+
+	// Hidden frames aren't sampled, the history restarts when the HUD shows again.
+	void set_visible(bool visible)
+	{
+		m_visible = visible;
+		m_next	  = 0;
+		m_count	  = 0;
+	}
+
+	void add_frame(float cpu_ms, float gpu_ms, const frame_counters::snapshot& counters, uint64_t allocation_total)
+	{
+		m_allocations	   = m_count > 0 ? allocation_total - m_allocation_total : 0;
+		m_allocation_total = allocation_total;
+		m_last			   = counters;
+
+		m_cpu_ms[m_next] = cpu_ms;
+		m_gpu_ms[m_next] = gpu_ms;
+		m_next			 = (m_next + 1) % k_history;
+		m_count			 = std::min(m_count + 1, k_history);
+	}
+
+	float latest(const std::array<float, k_history>& samples) const
+	{
+		return m_count > 0 ? samples[(m_next + k_history - 1) % k_history] : 0.0f;
+	}
+
+	void draw_graph(ImDrawList* draw_list, ImVec2 origin, ImVec2 size, float scale_ms, const std::array<float, k_history>& samples, ImU32 color)
+	{
+		const int first = (m_next + k_history - m_count) % k_history;
+		for (int i = 0; i < m_count; ++i)
+		{
+			const float ms = samples[(first + i) % k_history];
+			m_points[i]	   = ImVec2(origin.x + size.x * float(i) / float(k_history - 1), origin.y + size.y * (1.0f - std::min(ms / scale_ms, 1.0f)));
+		}
+		draw_list->AddPolyline(m_points.data(), m_count, color, 0, 1.0f);
+	}
+
+	// Reserves the graph area in the current window and draws the CPU series, plus the GPU one when it has samples.
+	void draw_graphs(ImVec2 size, bool gpu)
+	{
+		float peak_ms = k_budget_ms;
+		for (int i = 0; i < m_count; ++i)
+		{
+			peak_ms = std::max({peak_ms, m_cpu_ms[i], gpu ? m_gpu_ms[i] : 0.0f});
+		}
+		const float scale_ms = peak_ms * 1.1f;
+
+		const ImVec2 origin = ImGui::GetCursorScreenPos();
+		ImGui::Dummy(size);
+
+		ImDrawList* draw_list = ImGui::GetWindowDrawList();
+		const float budget_y  = origin.y + size.y * (1.0f - k_budget_ms / scale_ms);
+		draw_list->AddRectFilled(origin, ImVec2(origin.x + size.x, origin.y + size.y), IM_COL32(0, 0, 0, 96));
+		draw_list->AddLine(ImVec2(origin.x, budget_y), ImVec2(origin.x + size.x, budget_y), IM_COL32(255, 255, 255, 48));
+
+		draw_graph(draw_list, origin, size, scale_ms, m_cpu_ms, IM_COL32(110, 200, 255, 255));
+		if (gpu)
+		{
+			draw_graph(draw_list, origin, size, scale_ms, m_gpu_ms, IM_COL32(255, 170, 60, 255));
+		}
+	}
+};
+
+struct imgui_app_fw_impl : public imgui_app_fw_interface
+{
+	static inline imgui_app_fw_impl* singleton()
+	{
+		return reinterpret_cast<imgui_app_fw_impl*>(imgui_app_fw().get());
+	}
+
+	virtual mu::leaf::result<void> select_platform() noexcept
+	{
+		return {};
+	}
+
+	virtual mu::leaf::result<void> init() noexcept
+	{
+		BOOST_LEAF_CHECK(init({100.0f, 100.0f}, {1280.0f, 800.0f}));
+		return {};
+	}
+
+	virtual mu::leaf::result<bool> pump() noexcept
+	{
+		IMGUI_APP_FW_PROFILE_SCOPE(pump);
+
+		if (should_wait_for_events())
+		{
+			glfwWaitEventsTimeout(m_idle_wait_timeout);
+
+			// a blocking wait isn't a paced frame, start a fresh deadline chain
+			m_frame_pacer.reset();
 		}
 		else
 		{
-			m_window_specific.CreateInstance(surface_factory, m_shared.m_device->GetVkInstance());
+			const double refresh_rate = current_refresh_rate();
+			const double interval	  = m_frame_pacer.frame_interval(refresh_rate, any_window_focused(), glfwGetWindowAttrib(m_window, GLFW_ICONIFIED) != 0);
+			const double vsync_period = 1.0 / (refresh_rate > 0.0 ? refresh_rate : 60.0);
+
+			if (presented_nothing() && interval < vsync_period)
+			{
+				// no present blocked on vsync last frame, wait one refresh period for events instead of spinning a core
+				glfwWaitEventsTimeout(vsync_period);
+				m_frame_pacer.reset();
+			}
+			else
+			{
+				m_frame_pacer.pace(interval);
+				glfwPollEvents();
+			}
 		}
+		return !glfwWindowShouldClose(m_window);
+	}
 
-		m_shared.m_imgui_renderer.init(m_imgui_window, imgui_context, m_shared.m_frame_graph);
+	virtual mu::leaf::result<void> set_window_title(const char* title) noexcept
+	{
+		try
+		{
+			glfwSetWindowTitle(m_window, title);
+		}
+		catch (...)
+		{
+		}
+		return {};
+	}
 
-		FG::VulkanSwapchainCreateInfo swapchain_info;
+	virtual mu::leaf::result<void> begin_frame() noexcept
+	{
+		m_frame_cpu_start = std::chrono::steady_clock::now();
+
+		new_frame();
+
+		if (ImGuiViewport* main_viewport = ImGui::GetMainViewport(); main_viewport->PlatformRequestResize)
 		{
-			swapchain_info.surface		 = FGC::BitCast<FG::SurfaceVk_t>(m_window_specific.GetVkSurface());
-			swapchain_info.surfaceSize.x = uint32_t(viewport->Size.x);
-			swapchain_info.surfaceSize.y = uint32_t(viewport->Size.y);
+			m_render_thread.wait_idle();
+			((platform_renderer_data*)main_viewport->RendererUserData)->handle_resize(main_viewport);
+			main_viewport->PlatformRequestResize = false;
 		}
-		m_swapchain_id			   = m_shared.m_frame_graph->CreateSwapchain(swapchain_info);
-		m_is_primary			   = primary;
-		viewport->RendererUserData = this;
+
+		update_glyph_cache();
+
+		{
+			IMGUI_APP_FW_PROFILE_SCOPE(imgui_new_frame);
+			ImGui::NewFrame();
+		}
+
+#if IMGUI_APP_FW_CPU_PROFILER
+		m_ui_build_start_ns = steady_clock_ns();
+#endif
+		return {};
 	}
 
-	void handle_resize(ImGuiViewport* viewport)
+	virtual mu::leaf::result<void> end_frame(ImVec4 clear_color) noexcept
 	{
-		auto window = (GLFWwindow*)viewport->PlatformHandle;
-		int	 new_width, new_height;
-		glfwGetWindowSize(window, &new_width, &new_height);
+#if IMGUI_APP_FW_CPU_PROFILER
+		if (m_ui_build_start_ns != 0)
+		{
+			cpu_profiler::record(cpu_profiler::phase::ui_build, m_ui_build_start_ns, steady_clock_ns());
+			m_ui_build_start_ns = 0;
+		}
+#endif
+		if (m_hud.m_visible)
+		{
+			draw_performance_hud();
+		}
 
-		if (new_width > 0 && new_height > 0)
 		{
-			FG::VulkanSwapchainCreateInfo swapchain_info;
-			swapchain_info.surface		 = FG::BitCast<FG::SurfaceVk_t>(m_window_specific.GetVkSurface());
-			swapchain_info.surfaceSize.x = new_width;
-			swapchain_info.surfaceSize.y = new_height;
+			IMGUI_APP_FW_PROFILE_SCOPE(imgui_render);
+			ImGui::Render();
+		}
 
-			m_shared.m_frame_graph->WaitIdle();
+		ImGuiViewport*			main_viewport	   = ImGui::GetMainViewport();
+		platform_renderer_data* main_viewport_data = (platform_renderer_data*)main_viewport->RendererUserData;
+
+		if (main_viewport->PlatformRequestResize)
+		{
+			m_render_thread.wait_idle();
+			main_viewport_data->handle_resize(main_viewport);
+			main_viewport->PlatformRequestResize = false;
+		}
+
+		if (ImGui::GetIO().ConfigFlags & ImGuiConfigFlags_ViewportsEnable)
+		{
+			ImGui::UpdatePlatformWindows();
+		}
+
+		platform_renderer_data::m_shared.m_glyph_cache.scan_usage(ImGui::GetPlatformIO());
+		platform_renderer_data::use_font_scales(ImGui::GetPlatformIO(), ImGui::GetIO().ConfigFlags);
+
+		// uploads are recorded here, not on the render thread, so they can't overlap its submissions
+		if (platform_renderer_data::has_assets_to_load())
+		{
+			m_render_thread.wait_idle();
+		}
+		m_pending_task = main_viewport_data->load_assets(m_context);
+
+		if (m_render_thread.is_running())
+		{
+			submit_snapshot();
+		}
+		else
+		{
+			const auto record_start = std::chrono::steady_clock::now();
+
+			if ((ImGui::GetIO().ConfigFlags & ImGuiConfigFlags_ViewportsEnable) && platform_renderer_data::m_shared.m_parallel_viewports)
+			{
+				collect_recordings();
+				m_any_rendered = record_viewports(m_recordings, m_pending_task, true);
+			}
+			else
+			{
+				m_any_rendered = main_viewport_data->render_frame(m_context, main_viewport, ImGui::GetDrawData(), m_pending_task);
+
+				if (ImGui::GetIO().ConfigFlags & ImGuiConfigFlags_ViewportsEnable)
+				{
+					ImGui::RenderPlatformWindowsDefault(nullptr, nullptr);
+				}
+			}
+			finish_frame(record_start, m_any_rendered);
+		}
+
+		update_idle_state();
+		update_performance_hud();
+
+#if IMGUI_APP_FW_CPU_PROFILER
+		if (trace_recorder::window_ended() && !trace_recorder::finish())
+		{
+			return mu::leaf::new_error();
+		}
+#endif
+		return {};
+	}
+
+	virtual mu::leaf::result<void> set_parallel_viewport_recording(bool enable) noexcept
+	{
+		m_render_thread.wait_idle();
+		platform_renderer_data::m_shared.m_parallel_viewports = enable;
+		update_worker_pool();
+		return {};
+	}
+
+	virtual mu::leaf::result<void> set_parallel_geometry_upload(bool enable) noexcept
+	{
+		m_render_thread.wait_idle();
+		platform_renderer_data::m_shared.m_imgui_renderer.m_parallel_upload = enable;
+		update_worker_pool();
+		return {};
+	}
+
+	virtual mu::leaf::result<void> set_pooled_imgui_allocator(bool enable) noexcept
+	{
+		imgui_allocator::s_pooled = enable;
+		return {};
+	}
+
+	virtual mu::leaf::result<allocator_statistics> get_allocator_statistics() noexcept
+	{
+		allocator_statistics stats = imgui_allocator::statistics();
+		if (m_context)
+		{
+			imgui_allocator::add_category_bytes(*m_context, INOUT stats);
+		}
+		return stats;
+	}
+
+	virtual mu::leaf::result<void> set_render_thread(bool enable) noexcept
+	{
+		if (enable && !m_render_thread.is_running())
+		{
+			m_render_thread.start([this](draw_data_snapshot& snapshot) { render_snapshot(snapshot); });
+		}
+		else if (!enable)
+		{
+			m_render_thread.stop();
+		}
+		platform_renderer_data::m_shared.m_render_thread = enable;
+		return {};
+	}
+
+	virtual mu::leaf::result<void> set_frames_in_flight(uint32_t count) noexcept
+	{
+		m_render_thread.wait_idle();
+		platform_renderer_data::m_shared.m_imgui_renderer.m_frames_in_flight = std::clamp(count, 1u, imgui_renderer_window::k_max_frames_in_flight);
+		return {};
+	}
+
+	virtual mu::leaf::result<void> set_window_layer(ImGuiID window_id, bool enable) noexcept
+	{
+		m_render_thread.wait_idle();
+
+		auto&	   windows = platform_renderer_data::m_shared.m_layer_windows;
+		const auto it	   = std::find(windows.begin(), windows.end(), window_id);
+
+		if (enable && it == windows.end())
+		{
+			windows.push_back(window_id);
+		}
+		else if (!enable && it != windows.end())
+		{
+			windows.erase(it);
+		}
+		return {};
+	}
+
+	virtual mu::leaf::result<void> set_layer_budget(uint64_t bytes) noexcept
+	{
+		m_render_thread.wait_idle();
+		platform_renderer_data::m_shared.m_layer_budget = bytes;
+		return {};
+	}
+
+	virtual mu::leaf::result<layer_statistics> get_layer_statistics() noexcept
+	{
+		const auto& shared = platform_renderer_data::m_shared;
+
+		layer_statistics stats;
+		stats.layers	= shared.m_layer_count.load();
+		stats.bytes		= shared.m_layer_bytes.load();
+		stats.budget	= shared.m_layer_budget;
+		stats.renders	= shared.m_layer_renders.load();
+		stats.evictions = shared.m_layer_evictions.load();
+		return stats;
+	}
+
+	virtual mu::leaf::result<void> set_partial_redraw(bool enable) noexcept
+	{
+		m_render_thread.wait_idle();
+		platform_renderer_data::m_shared.m_partial_redraw = enable;
+		return {};
+	}
+
+	virtual mu::leaf::result<void> set_indirect_draw(bool enable) noexcept
+	{
+		m_render_thread.wait_idle();
+		platform_renderer_data::m_shared.m_imgui_renderer.m_indirect_draw = enable;
+		return {};
+	}
+
+	virtual mu::leaf::result<void> set_compact_vertices(bool enable) noexcept
+	{
+		m_render_thread.wait_idle();
+		platform_renderer_data::m_shared.m_imgui_renderer.m_compact_vertices = enable;
+		return {};
+	}
+
+	void update_glyph_cache()
+	{
+		auto& shared = platform_renderer_data::m_shared;
+		if (!shared.m_glyph_cache.enabled())
+		{
+			return;
+		}
+
+		uint8_t* pixels;
+		int		 width, height;
+
+		const size_t bytes_per_pixel = shared.m_imgui_renderer.get_font_pixels(m_context, OUT pixels, OUT width, OUT height);
+		shared.m_glyph_cache.m_sdf_spread = shared.m_imgui_renderer.m_sdf_fonts ? sdf_font_builder::k_spread : 0;
+		shared.m_glyph_cache.sync(m_context->IO.Fonts, pixels, bytes_per_pixel);
+		shared.m_glyph_cache.update(m_context->IO.Fonts, m_context->IO);
+	}
+
+	virtual mu::leaf::result<void> set_glyph_cache_pages(uint32_t pages) noexcept
+	{
+		auto& shared = platform_renderer_data::m_shared;
+
+		shared.m_glyph_cache.m_page_count = std::min(pages, glyph_cache::k_max_pages);
+		if (!m_context)
+		{
+			// reserved when the renderer builds the atlas
+			return {};
+		}
+
+		m_render_thread.wait_idle();
+
+		// the pages only exist after a rebuild, which also drops the cached glyphs
+		shared.m_glyph_cache.reserve(m_context->IO.Fonts);
+		m_context->IO.Fonts->ClearTexData();
+
+		uint8_t* pixels;
+		int		 width, height;
+		shared.m_imgui_renderer.get_font_pixels(m_context, OUT pixels, OUT width, OUT height);
 
-			m_swapchain_id = m_shared.m_frame_graph->CreateSwapchain(swapchain_info, m_swapchain_id.Release());
+		if (shared.m_frame_graph)
+		{
+			shared.m_frame_graph->ReleaseResource(INOUT shared.m_imgui_renderer.m_font_texture);
 		}
+		return {};
 	}
 
-	void destroy(ImGuiViewport* viewport)
+	virtual mu::leaf::result<void> request_glyphs(const char* utf8_text) noexcept
 	{
-		m_shared.m_frame_graph->ReleaseResource(m_swapchain_id);
-		m_shared.m_imgui_renderer.destroy(m_imgui_window, m_shared.m_frame_graph);
-
-		if (m_is_primary)
+		if (utf8_text)
 		{
-			m_shared.m_imgui_renderer.destroy_shared(m_shared.m_frame_graph);
-			m_shared.m_frame_graph->Deinitialize();
-			m_shared.m_frame_graph = nullptr;
-
-			m_shared.m_device->DestroyLogicalDevice();
-			m_shared.m_device->DestroyInstance();
-			m_shared.m_device.reset();
+			platform_renderer_data::m_shared.m_glyph_cache.request(utf8_text);
 		}
+		return {};
 	}
 
-	void end_frame()
+	virtual mu::leaf::result<glyph_cache_statistics> get_glyph_cache_statistics() noexcept
 	{
-		CHECK_ERR(m_shared.m_frame_graph->Flush());
+		const glyph_cache& cache = platform_renderer_data::m_shared.m_glyph_cache;
+
+		glyph_cache_statistics stats;
+		stats.pages		   = cache.m_page_count;
+		stats.glyphs	   = cache.m_glyphs;
+		stats.rasterized   = cache.m_rasterized;
+		stats.evictions	   = cache.m_evictions;
+		stats.misses	   = cache.m_misses;
+		stats.upload_bytes = cache.m_upload_bytes;
+		return stats;
 	}
 
-	FG::Task load_assets(ImGuiContext* ctx)
+	virtual mu::leaf::result<void> set_cache_directory(const char* path) noexcept
 	{
-		if (m_is_primary && !m_shared.m_imgui_renderer.m_font_texture)
-		{
-			FG::CommandBuffer cmdbuf = m_shared.m_frame_graph->Begin(FG::CommandBufferDesc{FG::EQueueType::Graphics});
-			m_shared.m_shared_tasks.clear();
-			auto new_task = m_shared.m_imgui_renderer.create_font_texture(ctx, cmdbuf);
-			m_shared.m_frame_graph->Execute(cmdbuf);
-			return new_task;
-		}
+		// the atlas may be converted on the render thread
+		m_render_thread.wait_idle();
 
-		return nullptr;
+		const std::filesystem::path directory = path ? std::filesystem::path{path} : std::filesystem::path{};
+		auto&						renderer  = platform_renderer_data::m_shared.m_imgui_renderer;
+
+		renderer.m_sdf.m_path		  = cache_file(directory, "sdf_cache");
+		renderer.m_atlas_cache.m_path = cache_file(directory, "font_cache");
+		return {};
 	}
 
-	void render_frame(ImGuiContext* ctx, ImGuiViewport* viewport, ImDrawData* draw_data, FG::Task dependent_task)
+	virtual mu::leaf::result<void> set_sdf_fonts(bool enable) noexcept
 	{
-		if (draw_data->TotalVtxCount > 0)
+		auto& renderer = platform_renderer_data::m_shared.m_imgui_renderer;
+		if (renderer.m_sdf_fonts == enable)
 		{
-			FG::CommandBuffer cmdbuf = m_shared.m_frame_graph->Begin(FG::CommandBufferDesc{FG::EQueueType::Graphics});
-			CHECK_ERR(cmdbuf);
+			return {};
+		}
 
-			{
-				auto dep_tasks = FGC::ArrayView<FG::Task>{&dependent_task, dependent_task ? size_t(1) : size_t(0)};
+		renderer.m_sdf_fonts = enable;
+		if (!m_context)
+		{
+			// applied when the renderer builds the atlas
+			return {};
+		}
 
-				FG::RawImageID image = cmdbuf->GetSwapchainImage(m_swapchain_id);
+		m_render_thread.wait_idle();
 
-				FG::RGBA32f		  _clearColor{0.45f, 0.55f, 0.60f, 1.00f};
-				FG::LogicalPassID pass_id = cmdbuf->CreateRenderPass(FG::RenderPassDesc{FG::int2{FG::float2{draw_data->DisplaySize.x, draw_data->DisplaySize.y}}}
-																		 .AddViewport(FG::float2{draw_data->DisplaySize.x, draw_data->DisplaySize.y})
-																		 .AddTarget(FG::RenderTargetID::Color_0, image, _clearColor, FG::EAttachmentStoreOp::Store));
-				FG::Task		  draw_ui = m_shared.m_imgui_renderer.draw(
-					 m_imgui_window, draw_data, ctx, cmdbuf, pass_id, dep_tasks, [&cmdbuf, &pass_id](const ImDrawList& cmd_list, const ImDrawCmd& cmd) -> FG::Task {
-						 return imgui_app_fw_interface::mutable_userdata(&cmdbuf, pass_id).call(cmd_list, cmd);
-					 });
-				FG::Unused(draw_ui);
+		// glyph padding, baked lines and oversampling differ between the modes, so the atlas is rebuilt
+		ImFontAtlas* atlas = m_context->IO.Fonts;
+		if (!enable)
+		{
+			renderer.m_sdf.restore(atlas);
+		}
+		atlas->ClearTexData();
 
-				CHECK_ERR(m_shared.m_frame_graph->Execute(cmdbuf));
-			}
+		uint8_t* pixels;
+		int		 width, height;
+		renderer.get_font_pixels(m_context, OUT pixels, OUT width, OUT height);
+
+		if (platform_renderer_data::m_shared.m_frame_graph)
+		{
+			platform_renderer_data::m_shared.m_frame_graph->ReleaseResource(INOUT renderer.m_font_texture);
 		}
+		return {};
 	}
-};
 
-struct imgui_app_fw_impl : public imgui_app_fw_interface
-{
-	static inline imgui_app_fw_impl* singleton()
+	virtual mu::leaf::result<void> set_alpha_font_atlas(bool enable) noexcept
 	{
-		return reinterpret_cast<imgui_app_fw_impl*>(imgui_app_fw().get());
+		auto& shared = platform_renderer_data::m_shared;
+		if (shared.m_imgui_renderer.m_alpha_font_atlas == enable)
+		{
+			return {};
+		}
+
+		m_render_thread.wait_idle();
+
+		// the next begin_frame() re-uploads the atlas in the new format
+		shared.m_imgui_renderer.m_alpha_font_atlas = enable;
+		if (shared.m_frame_graph)
+		{
+			shared.m_frame_graph->ReleaseResource(INOUT shared.m_imgui_renderer.m_font_texture);
+		}
+		return {};
 	}
 
-	virtual mu::leaf::result<void> select_platform() noexcept
+	virtual mu::leaf::result<void> set_dpi_font_atlases(bool enable, double evict_after_seconds) noexcept
 	{
+		m_render_thread.wait_idle();
+
+		// atlases that are no longer wanted are released by the next end_frame()
+		auto& renderer				 = platform_renderer_data::m_shared.m_imgui_renderer;
+		renderer.m_dpi_font_atlases	 = enable;
+		renderer.m_dpi_atlas_timeout = std::max(evict_after_seconds, 0.0);
 		return {};
 	}
 
-	virtual mu::leaf::result<void> init() noexcept
+	virtual mu::leaf::result<void> set_gpu_profiling(bool enable) noexcept
 	{
-		BOOST_LEAF_CHECK(init({100.0f, 100.0f}, {1280.0f, 800.0f}));
+		m_render_thread.wait_idle();
+		platform_renderer_data::m_shared.m_gpu_profiling = enable;
 		return {};
 	}
 
-	virtual mu::leaf::result<bool> pump() noexcept
+	virtual mu::leaf::result<gpu_timing_statistics> get_gpu_timing_statistics() noexcept
 	{
-		glfwPollEvents();
-		return !glfwWindowShouldClose(m_window);
+		auto& shared = platform_renderer_data::m_shared;
+
+		std::lock_guard<std::mutex> lock(shared.m_statistics_mutex);
+		gpu_timing_statistics		stats;
+		stats.supported		 = shared.m_gpu_timestamps;
+		stats.render_pass	 = shared.m_gpu_pass_times.summary();
+		stats.user_callbacks = shared.m_gpu_callback_times.summary();
+		return stats;
 	}
 
-	virtual mu::leaf::result<void> set_window_title(const char* title) noexcept
+	virtual mu::leaf::result<phase_statistics> get_phase_statistics(frame_phase phase, double window_seconds) noexcept
 	{
-		try
+		if (phase >= frame_phase::count)
 		{
-			glfwSetWindowTitle(m_window, title);
+			return phase_statistics{};
 		}
-		catch (...)
+#if IMGUI_APP_FW_CPU_PROFILER
+		return cpu_profiler::statistics(phase, window_seconds);
+#else
+		return phase_statistics{};
+#endif
+	}
+
+	virtual mu::leaf::result<void> start_trace(const char* json_path, double seconds) noexcept
+	{
+#if IMGUI_APP_FW_CPU_PROFILER
+		if (trace_recorder::start(json_path, seconds))
 		{
+			return {};
 		}
-		return {};
+#endif
+		return mu::leaf::new_error();
 	}
 
-	virtual mu::leaf::result<void> begin_frame() noexcept
+	virtual mu::leaf::result<void> stop_trace() noexcept
 	{
-		new_frame();
-
-		if (ImGuiViewport* main_viewport = ImGui::GetMainViewport(); main_viewport->PlatformRequestResize)
+#if IMGUI_APP_FW_CPU_PROFILER
+		if (trace_recorder::s_events && !trace_recorder::finish())
 		{
-			((platform_renderer_data*)main_viewport->RendererUserData)->handle_resize(main_viewport);
-			main_viewport->PlatformRequestResize = false;
+			return mu::leaf::new_error();
 		}
+#endif
+		return {};
+	}
 
-		ImGui::NewFrame();
-
+	virtual mu::leaf::result<void> set_performance_hud(bool visible, int toggle_key) noexcept
+	{
+		if (visible != m_hud.m_visible)
+		{
+			m_hud.set_visible(visible);
+		}
+		m_hud.m_toggle_key = toggle_key;
 		return {};
 	}
 
-	virtual mu::leaf::result<void> end_frame(ImVec4 clear_color) noexcept
+	// Collects the frame's counters every frame, so they restart from zero when the HUD shows, and samples them while it's visible.
+	void update_performance_hud()
 	{
-		ImGui::Render();
+		auto& shared = platform_renderer_data::m_shared;
 
-		ImGuiViewport*			main_viewport	   = ImGui::GetMainViewport();
-		platform_renderer_data* main_viewport_data = (platform_renderer_data*)main_viewport->RendererUserData;
+		const frame_counters::snapshot counters = shared.m_imgui_renderer.m_counters.collect();
+		if (!m_hud.m_visible)
+		{
+			return;
+		}
 
-		if (main_viewport->PlatformRequestResize)
+		double gpu_ms = 0.0;
+		if (shared.m_gpu_profiling)
 		{
-			main_viewport_data->handle_resize(main_viewport);
-			main_viewport->PlatformRequestResize = false;
+			std::lock_guard<std::mutex> lock(shared.m_statistics_mutex);
+			gpu_ms = shared.m_gpu_last_pass_ms;
 		}
 
-		if (ImGui::GetIO().ConfigFlags & ImGuiConfigFlags_ViewportsEnable)
+		uint64_t allocation_total = 0;
+		for (const uint64_t count : imgui_allocator::statistics().allocations)
 		{
-			ImGui::UpdatePlatformWindows();
+			allocation_total += count;
 		}
 
-		m_pending_task = main_viewport_data->load_assets(m_context);
-		main_viewport_data->render_frame(m_context, main_viewport, ImGui::GetDrawData(), m_pending_task);
+		const double cpu_ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - m_frame_cpu_start).count();
+		m_hud.add_frame(float(cpu_ms), float(gpu_ms), counters, allocation_total);
+	}
 
-		if (ImGui::GetIO().ConfigFlags & ImGuiConfigFlags_ViewportsEnable)
+	// Drawn into the main viewport before ImGui::Render(), showing the previous frame's numbers.
+	void draw_performance_hud()
+	{
+		const ImGuiViewport* viewport = ImGui::GetMainViewport();
+		ImGui::SetNextWindowPos(ImVec2(viewport->WorkPos.x + viewport->WorkSize.x - 8.0f, viewport->WorkPos.y + 8.0f), ImGuiCond_Always, ImVec2(1.0f, 0.0f));
+		ImGui::SetNextWindowViewport(viewport->ID);
+		ImGui::SetNextWindowBgAlpha(0.75f);
+
+		constexpr ImGuiWindowFlags flags = ImGuiWindowFlags_NoDecoration | ImGuiWindowFlags_AlwaysAutoResize | ImGuiWindowFlags_NoSavedSettings |
+										   ImGuiWindowFlags_NoFocusOnAppearing | ImGuiWindowFlags_NoNav | ImGuiWindowFlags_NoInputs;
+		if (ImGui::Begin("##imgui_app_fw_performance_hud", nullptr, flags))
+		{
+			const auto& shared = platform_renderer_data::m_shared;
+			const bool	gpu	   = shared.m_gpu_profiling;
+
+			ImGui::TextColored(ImVec4(0.43f, 0.78f, 1.0f, 1.0f), "CPU %.2f ms", m_hud.latest(m_hud.m_cpu_ms));
+			ImGui::SameLine();
+			if (gpu)
+			{
+				ImGui::TextColored(ImVec4(1.0f, 0.67f, 0.24f, 1.0f), "GPU %.2f ms", m_hud.latest(m_hud.m_gpu_ms));
+			}
+			else
+			{
+				ImGui::TextDisabled("GPU off, see set_gpu_profiling");
+			}
+			m_hud.draw_graphs(ImVec2(240.0f, 60.0f), gpu);
+
+			const frame_counters::snapshot& c = m_hud.m_last;
+			ImGui::Text("draw calls %llu, FG tasks %llu", (unsigned long long)c.m_draw_calls, (unsigned long long)c.m_fg_tasks);
+			ImGui::Text("vertices %llu, indices %llu", (unsigned long long)c.m_vertices, (unsigned long long)c.m_indices);
+			ImGui::Text("uploaded %.1f KB", double(c.m_upload_bytes) / 1024.0);
+
+			const auto&	   renderer	   = shared.m_imgui_renderer;
+			const uint64_t font_bytes  = renderer.m_font_atlas_bytes + renderer.m_dpi_atlas_bytes;
+			const uint64_t layer_bytes = shared.m_layer_bytes.load(std::memory_order_relaxed);
+			ImGui::Text("fonts %.1f MB, layers %.1f / %.1f MB", double(font_bytes) / 1048576.0, double(layer_bytes) / 1048576.0, double(shared.m_layer_budget) / 1048576.0);
+			ImGui::Text("glyph cache %llu glyphs in %u pages", (unsigned long long)shared.m_glyph_cache.m_glyphs, unsigned(shared.m_glyph_cache.m_page_count));
+			ImGui::Text("swapchain recreations %llu", (unsigned long long)c.m_swapchain_recreations);
+			ImGui::Text("ImGui allocations %llu, arena overflows %llu", (unsigned long long)m_hud.m_allocations,
+						(unsigned long long)shared.m_arena_overflows.load(std::memory_order_relaxed));
+		}
+		ImGui::End();
+	}
+
+	void update_worker_pool()
+	{
+		m_render_thread.wait_idle();
+
+		auto&	   shared = platform_renderer_data::m_shared;
+		const bool wanted = shared.m_parallel_viewports || shared.m_imgui_renderer.m_parallel_upload;
+		if (wanted && !shared.m_workers.is_running())
+		{
+			shared.m_workers.start(worker_pool::default_thread_count());
+		}
+		else if (!wanted)
 		{
-			ImGui::RenderPlatformWindowsDefault(nullptr, nullptr);
+			shared.m_workers.stop();
 		}
-		main_viewport_data->end_frame();
+	}
+
+	virtual mu::leaf::result<void> set_skip_unchanged_frames(bool enable) noexcept
+	{
+		m_render_thread.wait_idle();
+		platform_renderer_data::m_shared.m_skip_unchanged_frames = enable;
+		return {};
+	}
+
+	virtual mu::leaf::result<frame_statistics> get_frame_statistics() noexcept
+	{
+		auto& shared = platform_renderer_data::m_shared;
+
+		std::lock_guard<std::mutex> lock(shared.m_statistics_mutex);
+		frame_statistics			stats = shared.m_statistics;
+		stats.arena_high_water_bytes	  = shared.m_arena_high_water.load();
+		stats.arena_overflows			  = shared.m_arena_overflows.load();
+		stats.font_atlas_bytes			  = shared.m_imgui_renderer.m_font_atlas_bytes;
+		stats.font_upload_ms			  = shared.m_imgui_renderer.m_font_upload_ms;
+		stats.font_build_ms				  = shared.m_imgui_renderer.m_font_build_ms;
+		stats.dpi_font_atlas_bytes		  = shared.m_imgui_renderer.m_dpi_atlas_bytes;
+		return stats;
+	}
+
+	virtual mu::leaf::result<void> set_idle_policy(uint32_t idle_frames, double wait_timeout) noexcept
+	{
+		m_idle_frames_threshold = idle_frames;
+		m_idle_wait_timeout		= wait_timeout;
+		return {};
+	}
 
+	virtual mu::leaf::result<void> request_frames(uint32_t count) noexcept
+	{
+		m_requested_frames = std::max(m_requested_frames, count);
+		return {};
+	}
+
+	virtual mu::leaf::result<void> wake() noexcept
+	{
+		m_wake_requested.store(true, std::memory_order_release);
+		glfwPostEmptyEvent();
+		return {};
+	}
+
+	virtual mu::leaf::result<void> set_frame_pacing(const frame_pacing_settings& settings) noexcept
+	{
+		m_frame_pacer.m_settings = settings;
+		m_frame_pacer.reset();
 		return {};
 	}
 
+	virtual mu::leaf::result<frame_pacing_statistics> get_frame_pacing_statistics() noexcept
+	{
+		return m_frame_pacer.m_statistics;
+	}
+
 	virtual mu::leaf::result<void> destroy() noexcept
 	{
+		m_render_thread.stop();
+		platform_renderer_data::m_shared.m_render_thread = false;
+
+#if IMGUI_APP_FW_CPU_PROFILER
+		trace_recorder::finish(); // writes a trace still running, the window closed early
+#endif
+
 		shutdown_renderer();
 		shutdown_window();
 		ImGui::DestroyContext();
@@ -1022,9 +6369,222 @@ struct imgui_app_fw_impl : public imgui_app_fw_interface
 	bool		  m_need_monitor_update					  = true;
 	bool		  m_ready								  = false;
 	FG::Task	  m_pending_task						  = nullptr;
+	bool		  m_any_rendered						  = false;
+
+	performance_hud						  m_hud;
+	std::chrono::steady_clock::time_point m_frame_cpu_start; // begin_frame(), the HUD's CPU time runs to the end of end_frame()
+
+#if IMGUI_APP_FW_CPU_PROFILER
+	int64_t m_ui_build_start_ns = 0; // end of begin_frame(), the ui_build phase ends in end_frame()
+#endif
+
+	struct viewport_recording
+	{
+		ImGuiViewport*	  m_viewport;
+		ImDrawData*		  m_draw_data;
+		FG::CommandBuffer m_cmdbuf;
+		bool			  m_rendered;
+	};
+	std::vector<viewport_recording> m_recordings;		 // main thread
+	std::vector<viewport_recording> m_thread_recordings; // render thread
+
+	render_thread	  m_render_thread;
+	std::atomic<bool> m_thread_any_rendered{false}; // result of the last snapshot the render thread recorded
+
+	void collect_recordings()
+	{
+		ImGuiPlatformIO& platform_io = ImGui::GetPlatformIO();
+
+		m_recordings.clear();
+		for (int i = 0; i < platform_io.Viewports.Size; i++)
+		{
+			ImGuiViewport* viewport = platform_io.Viewports[i];
+			if (i > 0 && (viewport->Flags & ImGuiViewportFlags_Minimized))
+			{
+				continue;
+			}
+			m_recordings.push_back({viewport, viewport->DrawData, {}, false});
+		}
+	}
+
+	// Same work as render_frame + RenderPlatformWindowsDefault. With parallel set each viewport's command buffer is recorded on
+	// a worker thread, then all of them are submitted in viewport order. Returns true if any viewport was rendered.
+	bool record_viewports(std::vector<viewport_recording>& recordings, FG::Task pending_task, bool parallel)
+	{
+		struct record_args
+		{
+			std::vector<viewport_recording>& m_recordings;
+			FG::Task						 m_pending_task;
+			ImGuiContext*					 m_context;
+		} args{recordings, pending_task, m_context};
+
+		// capturing a single pointer keeps the std::function built by parallel_for in its small buffer, no allocation per frame
+		auto record = [&args](size_t i) {
+			viewport_recording&		rec	 = args.m_recordings[i];
+			platform_renderer_data* data = (platform_renderer_data*)rec.m_viewport->RendererUserData;
+			rec.m_rendered				 = data->record_frame(args.m_context, rec.m_viewport, rec.m_draw_data, args.m_pending_task, OUT rec.m_cmdbuf);
+		};
+
+		if (parallel)
+		{
+			platform_renderer_data::m_shared.m_workers.parallel_for(recordings.size(), record);
+		}
+		else
+		{
+			for (size_t i = 0; i < recordings.size(); ++i)
+			{
+				record(i);
+			}
+		}
+
+		bool any_rendered = false;
+		for (auto& rec : recordings)
+		{
+			if (rec.m_cmdbuf)
+			{
+				IMGUI_APP_FW_PROFILE_SCOPE(execute);
+				CHECK_ERR(platform_renderer_data::m_shared.m_frame_graph->Execute(rec.m_cmdbuf));
+			}
+			platform_renderer_data::count_viewport(rec.m_rendered);
+			any_rendered |= rec.m_rendered;
+		}
+		return any_rendered;
+	}
+
+	// Flushes the frame's submissions and updates the frame statistics. Runs on the render thread when there is one.
+	void finish_frame(std::chrono::steady_clock::time_point record_start, bool any_rendered)
+	{
+		const auto flush_start = std::chrono::steady_clock::now();
+		platform_renderer_data::end_frame();
+		const auto flush_end = std::chrono::steady_clock::now();
+
+		auto&						shared = platform_renderer_data::m_shared;
+		std::lock_guard<std::mutex> lock(shared.m_statistics_mutex);
+
+		auto& stats = shared.m_statistics;
+		++(any_rendered ? stats.frames_rendered : stats.frames_skipped);
+
+		// moving averages over roughly the last 32 frames
+		const double record_ms = std::chrono::duration<double, std::milli>(flush_start - record_start).count();
+		const double flush_ms  = std::chrono::duration<double, std::milli>(flush_end - flush_start).count();
+		stats.record_ms += (record_ms - stats.record_ms) / 32.0;
+		stats.flush_ms += (flush_ms - stats.flush_ms) / 32.0;
+	}
+
+	// Main thread side of the render thread: copies every viewport's draw data into the free snapshot and publishes it.
+	void submit_snapshot()
+	{
+		ImGuiPlatformIO&	platform_io = ImGui::GetPlatformIO();
+		const bool			viewports	= (ImGui::GetIO().ConfigFlags & ImGuiConfigFlags_ViewportsEnable) != 0;
+		draw_data_snapshot& snapshot	= m_render_thread.m_buffer.write_slot();
+
+		snapshot.begin(m_pending_task);
+		for (int i = 0; i < (viewports ? platform_io.Viewports.Size : 1); i++)
+		{
+			ImGuiViewport* viewport = platform_io.Viewports[i];
+			if ((i > 0 && (viewport->Flags & ImGuiViewportFlags_Minimized)) || !viewport->DrawData || !viewport->RendererUserData)
+			{
+				continue;
+			}
+			snapshot.add(viewport, viewport->DrawData);
+		}
+		snapshot.end();
+
+		m_render_thread.submit();
+
+		if (m_pending_task)
+		{
+			// a newer snapshot would recycle this one and lose its dependency on the asset upload
+			m_render_thread.wait_idle();
+		}
+
+		// the render thread reports one frame late, good enough for the idle policy
+		m_any_rendered = m_thread_any_rendered.load(std::memory_order_relaxed);
+	}
+
+	void render_snapshot(draw_data_snapshot& snapshot)
+	{
+		const auto record_start = std::chrono::steady_clock::now();
+
+		m_thread_recordings.clear();
+		for (auto& copy : snapshot.m_viewports)
+		{
+			m_thread_recordings.push_back({copy.m_viewport, &copy.m_draw_data, {}, false});
+		}
+
+		const bool any_rendered = record_viewports(m_thread_recordings, snapshot.m_pending_task, platform_renderer_data::m_shared.m_parallel_viewports);
+		finish_frame(record_start, any_rendered);
+
+		m_thread_any_rendered.store(any_rendered, std::memory_order_relaxed);
+	}
+
+	// idle policy, m_idle_frames_threshold == 0 keeps pump() polling every frame
+	uint32_t		  m_idle_frames_threshold = 0;
+	double			  m_idle_wait_timeout	  = 0.5;
+	uint32_t		  m_idle_frame_count	  = 0;
+	uint32_t		  m_requested_frames	  = 0;
+	bool			  m_input_seen			  = true;
+	std::atomic<bool> m_wake_requested{false};
+
+	frame_pacer		 m_frame_pacer;
+	std::vector<int> m_monitor_refresh_rates; // parallel to ImGuiPlatformIO::Monitors
+
+	double current_refresh_rate() const
+	{
+		auto main_viewport = static_cast<ImGuiViewportP*>(ImGui::GetMainViewport());
+		if (main_viewport->PlatformMonitor >= 0 && main_viewport->PlatformMonitor < int(m_monitor_refresh_rates.size()))
+		{
+			return double(m_monitor_refresh_rates[main_viewport->PlatformMonitor]);
+		}
+		return 0.0;
+	}
+
+	bool any_window_focused() const
+	{
+		ImGuiPlatformIO& platform_io = ImGui::GetPlatformIO();
+		for (int n = 0; n < platform_io.Viewports.Size; n++)
+		{
+			if (GLFWwindow* window = (GLFWwindow*)platform_io.Viewports[n]->PlatformHandle; window && glfwGetWindowAttrib(window, GLFW_FOCUSED) != 0)
+			{
+				return true;
+			}
+		}
+		return false;
+	}
+
+	void update_idle_state()
+	{
+		// With unchanged-frame skipping or partial redraw enabled a redrawn viewport means something animated without input.
+		const bool tracking		= platform_renderer_data::m_shared.m_skip_unchanged_frames || platform_renderer_data::m_shared.m_partial_redraw;
+		const bool animating	= tracking && m_any_rendered;
+		const bool uploading	= m_pending_task != nullptr || !platform_renderer_data::m_shared.m_imgui_renderer.m_font_texture;
+		const bool was_woken	= m_wake_requested.exchange(false, std::memory_order_acquire);
+		const bool has_activity = m_input_seen || animating || uploading || was_woken || m_requested_frames > 0;
+
+		m_idle_frame_count = has_activity ? 0 : m_idle_frame_count + 1;
+		m_input_seen	   = false;
+
+		if (m_requested_frames > 0)
+		{
+			--m_requested_frames;
+		}
+	}
+
+	// Every viewport was skipped as unchanged in the last frame, so nothing throttled the loop.
+	bool presented_nothing() const
+	{
+		const auto& shared = platform_renderer_data::m_shared;
+		return (shared.m_skip_unchanged_frames || shared.m_partial_redraw) && !m_any_rendered;
+	}
+
+	bool should_wait_for_events() const
+	{
+		return m_idle_frames_threshold > 0 && m_idle_frame_count >= m_idle_frames_threshold && !m_wake_requested.load(std::memory_order_acquire);
+	}
 
 	void on_mouse_button(GLFWwindow* window, int button, int action, int mods)
 	{
+		m_input_seen = true;
 		if (action == GLFW_PRESS && button >= 0 && button < IM_ARRAYSIZE(m_mouse_pressed))
 		{
 			m_mouse_pressed[button] = true;
@@ -1033,6 +6593,7 @@ struct imgui_app_fw_impl : public imgui_app_fw_interface
 
 	void on_scroll(GLFWwindow* window, double xoffset, double yoffset)
 	{
+		m_input_seen = true;
 		ImGuiIO& io = ImGui::GetIO();
 		io.MouseWheelH += (float)xoffset;
 		io.MouseWheel += (float)yoffset;
@@ -1040,10 +6601,16 @@ struct imgui_app_fw_impl : public imgui_app_fw_interface
 
 	void on_key(GLFWwindow* window, int key, int scancode, int action, int mods)
 	{
+		m_input_seen = true;
 		ImGuiIO& io = ImGui::GetIO();
 		if (action == GLFW_PRESS)
 		{
 			io.KeysDown[key] = true;
+
+			if (m_hud.m_toggle_key != 0 && key == m_hud.m_toggle_key)
+			{
+				m_hud.set_visible(!m_hud.m_visible);
+			}
 		}
 
 		if (action == GLFW_RELEASE)
@@ -1064,12 +6631,20 @@ struct imgui_app_fw_impl : public imgui_app_fw_interface
 
 	void on_char(GLFWwindow* window, unsigned int c)
 	{
+		m_input_seen = true;
 		ImGuiIO& io = ImGui::GetIO();
 		io.AddInputCharacter(c);
 	}
 
+	void on_cursor_activity(GLFWwindow* window)
+	{
+		// the cursor position itself is polled in update_mouse_pos_and_buttons, this only keeps the idle policy awake
+		m_input_seen = true;
+	}
+
 	void on_window_size(GLFWwindow* window, int, int)
 	{
+		m_input_seen = true;
 		if (ImGuiViewport* viewport = ImGui::FindViewportByPlatformHandle(window))
 		{
 			if (platform_window_data* data = (platform_window_data*)viewport->PlatformUserData)
@@ -1085,12 +6660,26 @@ struct imgui_app_fw_impl : public imgui_app_fw_interface
 		}
 	}
 
+	void on_window_refresh(GLFWwindow* window)
+	{
+		m_input_seen = true;
+		// the OS lost the window contents (exposed, restored, ...), the next frame can't be skipped
+		if (ImGuiViewport* viewport = ImGui::FindViewportByPlatformHandle(window))
+		{
+			if (platform_renderer_data* data = (platform_renderer_data*)viewport->RendererUserData)
+			{
+				data->m_needs_redraw = true;
+			}
+		}
+	}
+
 	void update_monitors()
 	{
 		ImGuiPlatformIO& platform_io	= ImGui::GetPlatformIO();
 		int				 monitors_count = 0;
 		GLFWmonitor**	 glfw_monitors	= glfwGetMonitors(&monitors_count);
 		platform_io.Monitors.resize(0);
+		m_monitor_refresh_rates.clear();
 		for (int n = 0; n < monitors_count; n++)
 		{
 			ImGuiPlatformMonitor monitor;
@@ -1112,6 +6701,7 @@ struct imgui_app_fw_impl : public imgui_app_fw_interface
 			glfwGetMonitorContentScale(glfw_monitors[n], &x_scale, &y_scale);
 			monitor.DpiScale = x_scale;
 			platform_io.Monitors.push_back(monitor);
+			m_monitor_refresh_rates.push_back(vid_mode->refreshRate);
 		}
 		m_need_monitor_update = false;
 	}
@@ -1183,6 +6773,9 @@ struct imgui_app_fw_impl : public imgui_app_fw_interface
 		glfwSetScrollCallback(window, [](GLFWwindow* window, double xoffset, double yoffset) -> void { singleton()->on_scroll(window, xoffset, yoffset); });
 		glfwSetKeyCallback(window, [](GLFWwindow* window, int key, int scancode, int action, int mods) -> void { singleton()->on_key(window, key, scancode, action, mods); });
 		glfwSetCharCallback(window, [](GLFWwindow* window, unsigned int c) -> void { singleton()->on_char(window, c); });
+		glfwSetCursorPosCallback(window, [](GLFWwindow* window, double, double) -> void { singleton()->on_cursor_activity(window); });
+		glfwSetCursorEnterCallback(window, [](GLFWwindow* window, int) -> void { singleton()->on_cursor_activity(window); });
+		glfwSetWindowFocusCallback(window, [](GLFWwindow* window, int) -> void { singleton()->on_cursor_activity(window); });
 		glfwSetMonitorCallback([](GLFWmonitor*, int) -> void { singleton()->m_need_monitor_update = true; });
 
 		// Update monitors the first time (note: monitor callback are broken in GLFW 3.2 and earlier, see github.com/glfw/glfw/issues/784)
@@ -1227,8 +6820,14 @@ struct imgui_app_fw_impl : public imgui_app_fw_interface
 
 				glfwSetCharCallback(data->m_window, [](GLFWwindow* window, unsigned int c) -> void { singleton()->on_char(window, c); });
 
+				glfwSetCursorPosCallback(data->m_window, [](GLFWwindow* window, double, double) -> void { singleton()->on_cursor_activity(window); });
+				glfwSetCursorEnterCallback(data->m_window, [](GLFWwindow* window, int) -> void { singleton()->on_cursor_activity(window); });
+				glfwSetWindowFocusCallback(data->m_window, [](GLFWwindow* window, int) -> void { singleton()->on_cursor_activity(window); });
+
 				glfwSetWindowSizeCallback(data->m_window, [](GLFWwindow* window, int a, int b) -> void { singleton()->on_window_size(window, a, b); });
 
+				glfwSetWindowRefreshCallback(data->m_window, [](GLFWwindow* window) -> void { singleton()->on_window_refresh(window); });
+
 				glfwSetWindowCloseCallback(data->m_window, [](GLFWwindow* window) -> void {
 					if (ImGuiViewport* viewport = ImGui::FindViewportByPlatformHandle(window))
 					{
@@ -1248,6 +6847,7 @@ struct imgui_app_fw_impl : public imgui_app_fw_interface
 							}
 						}
 						viewport->PlatformRequestMove = true;
+						singleton()->m_input_seen	  = true;
 					}
 				});
 			};
@@ -1367,16 +6967,21 @@ struct imgui_app_fw_impl : public imgui_app_fw_interface
 		}
 
 		glfwSetWindowSizeCallback(m_window, [](GLFWwindow* window, int a, int b) -> void { singleton()->on_window_size(window, a, b); });
+		glfwSetWindowRefreshCallback(m_window, [](GLFWwindow* window) -> void { singleton()->on_window_refresh(window); });
 
 		return true;
 	}
 
 	void shutdown_window()
 	{
+		glfwSetWindowRefreshCallback(m_window, nullptr);
 		glfwSetMouseButtonCallback(m_window, nullptr);
 		glfwSetScrollCallback(m_window, nullptr);
 		glfwSetKeyCallback(m_window, nullptr);
 		glfwSetCharCallback(m_window, nullptr);
+		glfwSetCursorPosCallback(m_window, nullptr);
+		glfwSetCursorEnterCallback(m_window, nullptr);
+		glfwSetWindowFocusCallback(m_window, nullptr);
 		glfwSetMonitorCallback(nullptr);
 
 		for (ImGuiMouseCursor cursor_n = 0; cursor_n < ImGuiMouseCursor_COUNT; cursor_n++)
@@ -1600,6 +7205,8 @@ struct imgui_app_fw_impl : public imgui_app_fw_interface
 
 	void new_frame()
 	{
+		IMGUI_APP_FW_PROFILE_SCOPE(new_frame);
+
 		ImGuiIO& io = ImGui::GetIO();
 		IM_ASSERT(
 			io.Fonts->IsBuilt() &&
@@ -1617,6 +7224,7 @@ struct imgui_app_fw_impl : public imgui_app_fw_interface
 
 		if (m_need_monitor_update)
 		{
+			IMGUI_APP_FW_PROFILE_SCOPE(update_monitors);
 			update_monitors();
 		}
 
@@ -1624,13 +7232,20 @@ struct imgui_app_fw_impl : public imgui_app_fw_interface
 		io.DeltaTime		= m_time > 0.0 ? (float)(current_time - m_time) : (float)(1.0f / 60.0f);
 		m_time				= current_time;
 
-		update_mouse_pos_and_buttons();
-		update_mouse_cursor();
+		{
+			IMGUI_APP_FW_PROFILE_SCOPE(update_mouse);
+			update_mouse_pos_and_buttons();
+			update_mouse_cursor();
+		}
+
+		IMGUI_APP_FW_PROFILE_SCOPE(update_gamepads);
 		update_gamepads();
 	}
 
 	void create_secondary_window(ImGuiViewport* viewport)
 	{
+		m_render_thread.wait_idle();
+
 		platform_renderer_data* data = IM_NEW(platform_renderer_data)();
 		viewport->RendererUserData	 = data;
 		data->init(ImGui::GetCurrentContext(), viewport, false);
@@ -1638,6 +7253,8 @@ struct imgui_app_fw_impl : public imgui_app_fw_interface
 
 	void destroy_secondary_window(ImGuiViewport* viewport)
 	{
+		m_render_thread.wait_idle();
+
 		// The main viewport (owned by the application) will always have RendererUserData == nullptr since we didn't create the data for it.
 		if (platform_renderer_data* data = (platform_renderer_data*)viewport->RendererUserData)
 		{
@@ -1649,6 +7266,8 @@ struct imgui_app_fw_impl : public imgui_app_fw_interface
 
 	void set_secondary_window_size(ImGuiViewport* viewport, ImVec2 size)
 	{
+		m_render_thread.wait_idle();
+
 		platform_renderer_data* data = (platform_renderer_data*)viewport->RendererUserData;
 		data->handle_resize(viewport);
 	}
@@ -1658,7 +7277,7 @@ struct imgui_app_fw_impl : public imgui_app_fw_interface
 		const ImVec4 clear_color = ImVec4(0.0f, 0.0f, 0.0f, 1.0f);
 
 		platform_renderer_data* data = (platform_renderer_data*)viewport->RendererUserData;
-		data->render_frame(ImGui::GetCurrentContext(), viewport, viewport->DrawData, m_pending_task);
+		m_any_rendered |= data->render_frame(ImGui::GetCurrentContext(), viewport, viewport->DrawData, m_pending_task);
 	}
 
 	void destroy_window()
@@ -1674,6 +7293,8 @@ struct imgui_app_fw_impl : public imgui_app_fw_interface
 
 	mu::leaf::result<void> init(ImVec2 p, ImVec2 s) noexcept
 	{
+		IMGUI_APP_FW_TRACE_THREAD("main");
+
 		if (!glfwInit())
 		{
 			return mu::leaf::new_error();
@@ -1688,6 +7309,9 @@ struct imgui_app_fw_impl : public imgui_app_fw_interface
 		// Setup Dear ImGui context
 		IMGUI_CHECKVERSION();
 
+		// before CreateContext, so the context itself comes from the pools too
+		ImGui::SetAllocatorFunctions(imgui_allocator::alloc, imgui_allocator::free, nullptr);
+
 		m_context	= ImGui::CreateContext();
 		ImGuiIO& io = ImGui::GetIO();
 		io.ConfigFlags |= ImGuiConfigFlags_NavEnableKeyboard; // Enable Keyboard Controls
@@ -0,0 +1,137 @@
+#pragma once
+
+#include <imgui_app_fw.h>
+
+#include <chrono>
+#include <cstdio>
+#include <initializer_list>
+#include <utility>
+
+// Shared by the benchmarks. Each one runs the framework in its own window, times a number of frames per configuration and
+// prints the CPU profiler's phase percentiles for just those frames. They need a display and a Vulkan device; lavapipe under
+// Xvfb is enough to compare configurations, not to compare against a GPU.
+struct bench_harness
+{
+	using clock_t	 = std::chrono::steady_clock;
+	using duration_t = std::chrono::duration<double>;
+	using phase		 = imgui_app_fw_interface::frame_phase;
+
+	static constexpr int k_warmup_frames = 10;
+
+	// Initializes the framework, runs body() and destroys it again. Returns the process exit code.
+	template <typename T_BODY>
+	static int run(const char* title, T_BODY&& body)
+	{
+		return run(title, []() -> mu::leaf::result<void> { return {}; }, std::forward<T_BODY>(body));
+	}
+
+	// Same, with setup() called right before init() for settings that have to be made before it.
+	template <typename T_SETUP, typename T_BODY>
+	static int run(const char* title, T_SETUP&& setup, T_BODY&& body)
+	{
+		return mu::leaf::try_handle_all(
+			[&]() -> mu::leaf::result<int> {
+				BOOST_LEAF_CHECK(imgui_app_fw()->select_platform());
+				BOOST_LEAF_CHECK(setup());
+				BOOST_LEAF_CHECK(imgui_app_fw()->init());
+
+				auto framework_guard = sg::make_scope_guard([]() {
+					if (auto res = imgui_app_fw()->destroy(); !res)
+					{
+						std::fprintf(stderr, "destroy failed\n");
+					}
+				});
+
+				BOOST_LEAF_CHECK(imgui_app_fw()->set_window_title(title));
+				BOOST_LEAF_CHECK(body());
+				return 0;
+			},
+			[](mu::leaf::error_info const& unmatched) {
+				std::fprintf(stderr, "failed\n");
+				return 1;
+			});
+	}
+
+	// Runs frame_count frames of ui(), returns their wall time in seconds. Stops early when the window is closed.
+	template <typename T_UI>
+	static mu::leaf::result<double> run_frames(int frame_count, T_UI&& ui)
+	{
+		const auto start = clock_t::now();
+		for (int i = 0; i < frame_count; ++i)
+		{
+			BOOST_LEAF_AUTO(running, imgui_app_fw()->pump());
+			if (!running)
+			{
+				break;
+			}
+
+			BOOST_LEAF_CHECK(imgui_app_fw()->begin_frame());
+			ui();
+			BOOST_LEAF_CHECK(imgui_app_fw()->end_frame(ImVec4(0.0f, 0.0f, 0.0f, 1.0f)));
+		}
+		return duration_t(clock_t::now() - start).count();
+	}
+
+	// Warms up, then times frame_count frames of ui() and prints the given phases over only those frames.
+	template <typename T_UI>
+	static mu::leaf::result<void> measure(const char* label, int frame_count, T_UI&& ui, std::initializer_list<phase> phases)
+	{
+		BOOST_LEAF_CHECK(run_frames(k_warmup_frames, ui));
+		BOOST_LEAF_AUTO(seconds, run_frames(frame_count, ui));
+
+		std::printf("%s: %.3f ms per frame\n", label, seconds * 1000.0 / frame_count);
+		for (const phase p : phases)
+		{
+			// the samples that ended within the run, the warm-up frames ended before it
+			BOOST_LEAF_AUTO(stats, imgui_app_fw()->get_phase_statistics(p, seconds));
+			if (!stats.available)
+			{
+				std::printf("  phase timings need IMGUI_APP_FW_CPU_PROFILER\n");
+				break;
+			}
+			std::printf(
+				"  %-16s p50 %8.3f  p95 %8.3f  max %8.3f ms  (%llu samples)\n", phase_name(p), stats.p50_ms, stats.p95_ms, stats.max_ms, (unsigned long long)stats.samples);
+		}
+		return {};
+	}
+
+	static const char* phase_name(phase p)
+	{
+		static const char* const k_names[] = {
+			"pump",
+			"new_frame",
+			"update_monitors",
+			"update_mouse",
+			"update_gamepads",
+			"imgui_new_frame",
+			"ui_build",
+			"imgui_render",
+			"create_buffers",
+			"draw",
+			"execute",
+			"flush"};
+		static_assert(sizeof(k_names) / sizeof(k_names[0]) == size_t(phase::count));
+		return k_names[size_t(p)];
+	}
+
+	// An undecorated window at pos filled with a grid of solid rects until its draw list holds vertex_count more vertices. Solid
+	// rects without rounding are 4 vertices and 6 indices each, with no anti-aliasing fringe.
+	static void geometry_window(const char* name, ImVec2 pos, ImVec2 size, int vertex_count)
+	{
+		ImGui::SetNextWindowPos(pos);
+		ImGui::SetNextWindowSize(size);
+		ImGui::Begin(name, nullptr, ImGuiWindowFlags_NoDecoration | ImGuiWindowFlags_NoSavedSettings | ImGuiWindowFlags_NoInputs);
+
+		constexpr int k_columns = 256;
+		constexpr int k_rows	= 128;
+		const ImVec2  cell		= ImVec2(size.x / k_columns, size.y / k_rows);
+
+		ImDrawList* draw_list = ImGui::GetWindowDrawList();
+		for (int i = 0; i < vertex_count / 4; ++i)
+		{
+			const ImVec2 min = ImVec2(pos.x + float(i % k_columns) * cell.x, pos.y + float((i / k_columns) % k_rows) * cell.y);
+			draw_list->AddRectFilled(min, ImVec2(min.x + cell.x, min.y + cell.y), IM_COL32((i * 37) & 255, (i * 11) & 255, (i * 5) & 255, 255));
+		}
+		ImGui::End();
+	}
+};
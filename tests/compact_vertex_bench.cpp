@@ -0,0 +1,83 @@
+#include <compact_vertex.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+
+// Microbenchmark of compact_vertex_packer: the SIMD kernel against the scalar reference and a plain copy of the 20 byte
+// ImDrawVert data, best of k_runs over a UI-like vertex stream. Fails if the kernel disagrees with the reference by more than
+// one unit (SIMD rounds ties to even, lround away from zero) or misses an out of range vertex.
+int main(int, char**)
+{
+	constexpr size_t k_vertex_count = 1000000;
+	constexpr int	 k_runs			= 20;
+	const ImVec2	 origin			= ImVec2(100.0f, 50.0f);
+
+	// positions on a quarter pixel grid inside a 4k viewport, UVs anywhere in [0, 1]
+	std::vector<ImDrawVert> src(k_vertex_count);
+	uint32_t				seed = 1;
+
+	auto next = [&seed]() {
+		seed = seed * 1664525u + 1013904223u;
+		return seed >> 8;
+	};
+	for (ImDrawVert& v : src)
+	{
+		v.pos = ImVec2(origin.x + float(next() % (3840 * 4)) / 4.0f, origin.y + float(next() % (2160 * 4)) / 4.0f);
+		v.uv  = ImVec2(float(next() % 65536) / 65535.0f, float(next() % 65536) / 65535.0f);
+		v.col = next();
+	}
+
+	std::vector<compact_vert> packed(k_vertex_count);
+	std::vector<compact_vert> reference(k_vertex_count);
+	std::vector<ImDrawVert>	  copied(k_vertex_count);
+
+	auto time_best_ms = [](auto&& body) {
+		double best = 1e30;
+		for (int run = 0; run < k_runs; ++run)
+		{
+			const auto start = std::chrono::steady_clock::now();
+			body();
+			best = std::min(best, std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count());
+		}
+		return best;
+	};
+
+	bool		 fits		  = true;
+	const double copy_ms	  = time_best_ms([&]() { std::memcpy(copied.data(), src.data(), src.size() * sizeof(ImDrawVert)); });
+	const double pack_ms	  = time_best_ms([&]() { fits &= compact_vertex_packer::pack(src.data(), src.size(), packed.data(), origin); });
+	const double reference_ms = time_best_ms([&]() { fits &= compact_vertex_packer::pack_scalar(src.data(), src.size(), reference.data(), origin); });
+
+	// throughput in GB of ImDrawVert read per second
+	const double gb = double(k_vertex_count * sizeof(ImDrawVert)) * 1e-9;
+	std::printf("%zu vertices, %.1f MB of ImDrawVert\n", k_vertex_count, gb * 1000.0);
+	std::printf("  memcpy ImDrawVert   %8.3f ms  %7.2f GB/s\n", copy_ms, gb / (copy_ms * 1e-3));
+	std::printf("  pack                %8.3f ms  %7.2f GB/s\n", pack_ms, gb / (pack_ms * 1e-3));
+	std::printf("  pack_scalar         %8.3f ms  %7.2f GB/s\n", reference_ms, gb / (reference_ms * 1e-3));
+
+	size_t mismatches = 0;
+	for (size_t i = 0; i < k_vertex_count; ++i)
+	{
+		const compact_vert& a = packed[i];
+		const compact_vert& b = reference[i];
+		if (std::abs(a.pos[0] - b.pos[0]) > 1 || std::abs(a.pos[1] - b.pos[1]) > 1 || std::abs(a.uv[0] - b.uv[0]) > 1 || std::abs(a.uv[1] - b.uv[1]) > 1 ||
+			a.col != b.col)
+		{
+			++mismatches;
+		}
+	}
+
+	// one vertex past the int16 range, anywhere in the stream, has to reject the whole frame
+	src[k_vertex_count / 2].pos.x = origin.x + compact_vertex_packer::k_pos_max + 1.0f;
+	const bool rejected			  = !compact_vertex_packer::pack(src.data(), src.size(), packed.data(), origin);
+
+	if (!fits || mismatches > 0 || !rejected)
+	{
+		std::fprintf(stderr, "FAILED: %s, %zu mismatches, out of range vertex %s\n", fits ? "in range" : "reported out of range", mismatches, rejected ? "rejected" : "accepted");
+		return 1;
+	}
+	return 0;
+}
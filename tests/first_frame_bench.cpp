@@ -0,0 +1,40 @@
+#include "bench_common.h"
+
+#include <cstring>
+#include <filesystem>
+#include <string>
+#include <system_error>
+
+// Time from init() to the end of the first frame, and the part of it spent building or loading the font atlas. The caches go to
+// a directory of their own under the temp directory. Pass --cold to clear it first; a run after that loads the cached atlas.
+int main(int argc, char** argv)
+{
+	const bool					cold	  = argc > 1 && std::strcmp(argv[1], "--cold") == 0;
+	const std::filesystem::path cache_dir = std::filesystem::temp_directory_path() / "imgui_app_fw_first_frame_bench";
+	const std::string			cache_str = cache_dir.string();
+
+	std::error_code ec;
+	if (cold)
+	{
+		std::filesystem::remove_all(cache_dir, ec);
+	}
+	const bool cached = std::filesystem::exists(cache_dir / "font_cache", ec);
+
+	bench_harness::clock_t::time_point start;
+	return bench_harness::run(
+		"first_frame_bench",
+		[&]() -> mu::leaf::result<void> {
+			BOOST_LEAF_CHECK(imgui_app_fw()->set_cache_directory(cache_str.c_str()));
+			start = bench_harness::clock_t::now();
+			return {};
+		},
+		[&]() -> mu::leaf::result<void> {
+			BOOST_LEAF_CHECK(bench_harness::run_frames(1, []() { ImGui::Text("first frame"); }));
+			const double first_frame_ms = std::chrono::duration<double, std::milli>(bench_harness::clock_t::now() - start).count();
+
+			BOOST_LEAF_AUTO(stats, imgui_app_fw()->get_frame_statistics());
+			std::printf(
+				"%s font cache: first frame %.1f ms after init(), font atlas %.1f ms\n", cached ? "warm" : "cold", first_frame_ms, stats.font_build_ms);
+			return {};
+		});
+}
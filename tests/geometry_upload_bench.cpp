@@ -0,0 +1,33 @@
+#include "bench_common.h"
+
+// create_buffers time for one window of solid rects at 100k, 1M and 5M vertices, copied on the calling thread and split over
+// the worker pool. Frames under the parallel upload threshold (1 MB of vertices and indices) stay on one thread either way.
+int main(int, char**)
+{
+	return bench_harness::run("geometry_upload_bench", []() -> mu::leaf::result<void> {
+		constexpr int k_vertex_counts[] = {
+			100000,
+			1000000,
+			5000000};
+
+		for (const int vertex_count : k_vertex_counts)
+		{
+			for (const bool parallel : {false, true})
+			{
+				BOOST_LEAF_CHECK(imgui_app_fw()->set_parallel_geometry_upload(parallel));
+
+				char label[64];
+				std::snprintf(label, sizeof(label), "%d vertices, %s", vertex_count, parallel ? "parallel upload" : "single thread");
+
+				BOOST_LEAF_CHECK(bench_harness::measure(
+					label, 30,
+					[vertex_count]() {
+						const ImGuiViewport* viewport = ImGui::GetMainViewport();
+						bench_harness::geometry_window("geometry", viewport->Pos, viewport->Size, vertex_count);
+					},
+					{bench_harness::phase::create_buffers, bench_harness::phase::draw, bench_harness::phase::flush}));
+			}
+		}
+		return {};
+	});
+}
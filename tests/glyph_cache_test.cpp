@@ -0,0 +1,117 @@
+#include "bench_common.h"
+
+#include <cstdint>
+
+// Cycles Latin-1 glyphs through a glyph cache small enough that they evict each other, and fails if a font's glyph count
+// drifts from its baked glyphs plus the cached ones. The default font is added a second time, large and with only ASCII baked,
+// so every requested glyph goes through the cache.
+namespace
+{
+constexpr int	   k_batch_size	   = 16;
+constexpr int	   k_batches	   = 4;
+constexpr int	   k_rounds		   = 2;
+constexpr int	   k_batch_frames  = 130; // longer than the cache keeps glyphs that are neither drawn nor requested
+constexpr uint32_t k_pages		   = 2;
+constexpr float	   k_font_size	   = 96.0f;
+constexpr int	   k_max_reported  = 10;
+constexpr ImWchar  k_first_glyph   = 0xC0;
+constexpr ImWchar  k_baked_range[] = {0x0020, 0x007E, 0};
+
+// UTF-8 of the batch's codepoints, all of them take two bytes
+void batch_text(int batch, char (&text)[k_batch_size * 2 + 1])
+{
+	for (int i = 0; i < k_batch_size; ++i)
+	{
+		const unsigned c = unsigned(k_first_glyph + batch * k_batch_size + i);
+		text[i * 2]		 = char(0xC0 | (c >> 6));
+		text[i * 2 + 1]	 = char(0x80 | (c & 0x3F));
+	}
+	text[k_batch_size * 2] = 0;
+}
+} // namespace
+
+int main()
+{
+	int failed_frames = 0;
+	int checked		  = 0;
+
+	const int exit_code = bench_harness::run(
+		"glyph cache test",
+		[]() -> mu::leaf::result<void> {
+			// no cache files, the atlas is rebuilt below anyway
+			BOOST_LEAF_CHECK(imgui_app_fw()->set_cache_directory(""));
+			return {};
+		},
+		[&]() -> mu::leaf::result<void> {
+			ImGui::GetIO().IniFilename = nullptr;
+			BOOST_LEAF_CHECK(bench_harness::run_frames(1, []() {}));
+
+			ImFontConfig config;
+			config.SizePixels  = k_font_size;
+			config.GlyphRanges = k_baked_range;
+			ImFont* font	   = ImGui::GetIO().Fonts->AddFontDefault(&config);
+
+			// rebuilds the atlas with the new font and the cache pages
+			BOOST_LEAF_CHECK(imgui_app_fw()->set_glyph_cache_pages(k_pages));
+
+			int64_t baked = -1;
+			for (int round = 0; round < k_rounds; ++round)
+			{
+				for (int batch = 0; batch < k_batches; ++batch)
+				{
+					char text[k_batch_size * 2 + 1];
+					batch_text(batch, text);
+					BOOST_LEAF_CHECK(imgui_app_fw()->request_glyphs(text));
+
+					int frame = 0;
+					BOOST_LEAF_CHECK(bench_harness::run_frames(k_batch_frames, [&]() {
+						auto stats = imgui_app_fw()->get_glyph_cache_statistics();
+						if (!stats)
+						{
+							return;
+						}
+
+						const int64_t size = int64_t(font->Glyphs.Size) - int64_t(stats->glyphs);
+						baked			   = baked < 0 ? size : baked;
+						if (size != baked)
+						{
+							if (failed_frames < k_max_reported)
+							{
+								std::printf(
+									"round %d, batch %d, frame %d: %d glyphs, expected %lld\n", round, batch, frame, font->Glyphs.Size,
+									(long long)(baked + int64_t(stats->glyphs)));
+							}
+							++failed_frames;
+						}
+						++checked;
+
+						// drawn only on the first frames, so the batch goes cold before the next one is requested
+						if (frame++ < 2)
+						{
+							ImGui::SetNextWindowPos(ImVec2(10.0f, 10.0f));
+							ImGui::Begin("glyphs", nullptr, ImGuiWindowFlags_AlwaysAutoResize | ImGuiWindowFlags_NoSavedSettings);
+							ImGui::PushFont(font);
+							ImGui::TextUnformatted(text);
+							ImGui::PopFont();
+							ImGui::End();
+						}
+					}));
+				}
+			}
+
+			BOOST_LEAF_AUTO(stats, imgui_app_fw()->get_glyph_cache_statistics());
+			std::printf(
+				"%llu glyphs rasterized, %llu evictions, %llu misses\n", (unsigned long long)stats.rasterized, (unsigned long long)stats.evictions,
+				(unsigned long long)stats.misses);
+			if (stats.evictions == 0)
+			{
+				// nothing was evicted and re-added, so the check above didn't cover anything
+				std::printf("no evictions, the cache is too large for the batches\n");
+				++failed_frames;
+			}
+			return {};
+		});
+
+	std::printf("%d of %d frames had a wrong glyph count\n", failed_frames, checked);
+	return exit_code != 0 || failed_frames != 0 ? 1 : 0;
+}
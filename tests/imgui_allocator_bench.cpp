@@ -0,0 +1,63 @@
+#include "bench_common.h"
+
+// NewFrame and Render cost of a widget-heavy UI with ImGui's heap going to malloc and through the pooled allocator. The
+// allocator's category counters are printed after each run.
+namespace
+{
+constexpr int k_window_count = 40;
+
+void widget_windows()
+{
+	static float values[k_window_count][4] = {};
+	static bool	 flags[k_window_count]	   = {};
+
+	const ImGuiViewport* viewport = ImGui::GetMainViewport();
+	const ImVec2		 size	  = ImVec2(viewport->Size.x / 8.0f, viewport->Size.y / 5.0f);
+	for (int i = 0; i < k_window_count; ++i)
+	{
+		char name[32];
+		std::snprintf(name, sizeof(name), "widgets %d", i);
+
+		ImGui::SetNextWindowPos(ImVec2(viewport->Pos.x + float(i % 8) * size.x, viewport->Pos.y + float(i / 8) * size.y));
+		ImGui::SetNextWindowSize(size);
+		ImGui::Begin(name, nullptr, ImGuiWindowFlags_NoSavedSettings);
+		ImGui::Text("window %d", i);
+		ImGui::SliderFloat4("values", values[i], 0.0f, 1.0f);
+		ImGui::Checkbox("flag", &flags[i]);
+		for (int j = 0; j < 10; ++j)
+		{
+			ImGui::PushID(j);
+			ImGui::Button("button");
+			ImGui::SameLine();
+			ImGui::Selectable("item", j == i % 10);
+			ImGui::PopID();
+		}
+		ImGui::End();
+	}
+}
+
+mu::leaf::result<void> print_allocator_statistics()
+{
+	BOOST_LEAF_AUTO(stats, imgui_app_fw()->get_allocator_statistics());
+	std::printf(
+		"  live %llu KB (draw lists %llu, windows %llu, storage %llu), slabs %llu KB\n", (unsigned long long)(stats.live_bytes / 1024),
+		(unsigned long long)(stats.draw_list_bytes / 1024), (unsigned long long)(stats.window_bytes / 1024), (unsigned long long)(stats.storage_bytes / 1024),
+		(unsigned long long)(stats.slab_bytes / 1024));
+	return {};
+}
+} // namespace
+
+int main(int, char**)
+{
+	return bench_harness::run("imgui_allocator_bench", []() -> mu::leaf::result<void> {
+		for (const bool pooled : {false, true})
+		{
+			BOOST_LEAF_CHECK(imgui_app_fw()->set_pooled_imgui_allocator(pooled));
+			BOOST_LEAF_CHECK(bench_harness::measure(
+				pooled ? "pooled allocator" : "malloc", 300, widget_windows,
+				{bench_harness::phase::imgui_new_frame, bench_harness::phase::ui_build, bench_harness::phase::imgui_render}));
+			BOOST_LEAF_CHECK(print_allocator_statistics());
+		}
+		return {};
+	});
+}
@@ -0,0 +1,43 @@
+#include "bench_common.h"
+
+#include <algorithm>
+
+// Index upload cost of the two index paths at the same vertex count. One window holding every vertex keeps ImDrawIdx indices,
+// the same geometry split over windows of at most 64k vertices each is narrowed to 16 bits when ImDrawIdx is 32 bits. Build
+// ImGui and the framework with ImDrawIdx defined as unsigned int to compare them, with 16 bit ImDrawIdx both runs upload 16 bit
+// indices and only show the cost of the extra draw lists.
+int main(int, char**)
+{
+	return bench_harness::run("index_repack_bench", []() -> mu::leaf::result<void> {
+		static constexpr int k_vertex_count	 = 1000000;
+		static constexpr int k_list_vertices = 60000;
+		static constexpr int k_list_count	 = (k_vertex_count + k_list_vertices - 1) / k_list_vertices;
+
+		std::printf("ImDrawIdx is %d bits\n", int(sizeof(ImDrawIdx) * 8));
+
+		BOOST_LEAF_CHECK(bench_harness::measure(
+			"one draw list, ImDrawIdx indices", 60,
+			[]() {
+				const ImGuiViewport* viewport = ImGui::GetMainViewport();
+				bench_harness::geometry_window("geometry", viewport->Pos, viewport->Size, k_vertex_count);
+			},
+			{bench_harness::phase::create_buffers, bench_harness::phase::draw}));
+
+		BOOST_LEAF_CHECK(bench_harness::measure(
+			"64k vertex draw lists, 16 bit indices", 60,
+			[]() {
+				const ImGuiViewport* viewport = ImGui::GetMainViewport();
+				const ImVec2		 size	  = ImVec2(viewport->Size.x / 4.0f, viewport->Size.y / 5.0f);
+				for (int i = 0; i < k_list_count; ++i)
+				{
+					char name[32];
+					std::snprintf(name, sizeof(name), "geometry %d", i);
+
+					const ImVec2 pos = ImVec2(viewport->Pos.x + float(i % 4) * size.x, viewport->Pos.y + float(i / 4) * size.y);
+					bench_harness::geometry_window(name, pos, size, std::min(k_list_vertices, k_vertex_count - i * k_list_vertices));
+				}
+			},
+			{bench_harness::phase::create_buffers, bench_harness::phase::draw}));
+		return {};
+	});
+}
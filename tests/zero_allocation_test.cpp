@@ -0,0 +1,146 @@
+#include "bench_common.h"
+
+#include <atomic>
+#include <cstdint>
+#include <cstdlib>
+#include <new>
+
+// Runs a widget-heavy UI and fails if any frame after the warm-up allocates. Every operator new in the process is counted,
+// ImGui's own heap goes through the framework's allocator and is counted by its statistics. Numbers are printed with a fixed
+// number of digits so the draw lists stop growing during the warm-up.
+
+namespace
+{
+std::atomic<uint64_t> g_new_count{0};
+
+constexpr int k_warmup_frames = 100;
+constexpr int k_test_frames	  = 1000;
+constexpr int k_max_reported  = 10;
+
+uint64_t imgui_allocation_count()
+{
+	uint64_t count = 0;
+	if (auto stats = imgui_app_fw()->get_allocator_statistics())
+	{
+		for (const uint64_t allocations : stats->allocations)
+		{
+			count += allocations;
+		}
+	}
+	return count;
+}
+
+void demo_ui(int frame)
+{
+	static float	   values[64] = {};
+	static float	   slider	  = 0.5f;
+	static bool		   checkbox	  = true;
+	static int		   combo_item = 0;
+	static char		   text[64]	  = "edit me";
+	static const char* items[]	  = {"first", "second", "third"};
+
+	values[frame % 64] = float(frame % 17) / 17.0f;
+
+	ImGui::SetNextWindowPos(ImVec2(10.0f, 10.0f), ImGuiCond_Once);
+	ImGui::SetNextWindowSize(ImVec2(500.0f, 600.0f), ImGuiCond_Once);
+	ImGui::Begin("Widgets");
+	ImGui::Text("frame %03d", frame % 1000);
+	ImGui::SliderFloat("slider", &slider, 0.0f, 1.0f);
+	ImGui::Checkbox("checkbox", &checkbox);
+	ImGui::Combo("combo", &combo_item, items, IM_ARRAYSIZE(items));
+	ImGui::InputText("text", text, sizeof(text));
+	ImGui::PlotLines("plot", values, IM_ARRAYSIZE(values), 0, nullptr, 0.0f, 1.0f, ImVec2(0.0f, 80.0f));
+	ImGui::ProgressBar(float(frame % 100) / 100.0f);
+
+	if (ImGui::CollapsingHeader("tree", ImGuiTreeNodeFlags_DefaultOpen))
+	{
+		for (int i = 0; i < 8; ++i)
+		{
+			ImGui::SetNextItemOpen(true, ImGuiCond_Once);
+			if (ImGui::TreeNode((void*)(intptr_t)i, "node %d", i))
+			{
+				ImGui::BulletText("value %03d", (frame + i) % 1000);
+				ImGui::TreePop();
+			}
+		}
+	}
+
+	if (ImGui::BeginTable("table", 3, ImGuiTableFlags_Borders | ImGuiTableFlags_RowBg))
+	{
+		for (int row = 0; row < 20; ++row)
+		{
+			ImGui::TableNextRow();
+			for (int column = 0; column < 3; ++column)
+			{
+				ImGui::TableSetColumnIndex(column);
+				ImGui::Text("%d, %d: %03d", row, column, (frame * (row + 1)) % 997);
+			}
+		}
+		ImGui::EndTable();
+	}
+
+	ImGui::BeginChild("child", ImVec2(0.0f, 120.0f), true);
+	for (int i = 0; i < 50; ++i)
+	{
+		ImGui::Selectable("selectable", i == frame % 50);
+	}
+	ImGui::EndChild();
+	ImGui::End();
+}
+} // namespace
+
+void* operator new(size_t size)
+{
+	g_new_count.fetch_add(1, std::memory_order_relaxed);
+	if (void* p = std::malloc(size != 0 ? size : 1))
+	{
+		return p;
+	}
+	throw std::bad_alloc();
+}
+
+void operator delete(void* p) noexcept
+{
+	std::free(p);
+}
+
+void operator delete(void* p, size_t) noexcept
+{
+	std::free(p);
+}
+
+int main()
+{
+	int failed_frames = 0;
+
+	const int exit_code = bench_harness::run("zero allocation test", [&]() -> mu::leaf::result<void> {
+		// no .ini writes
+		ImGui::GetIO().IniFilename = nullptr;
+
+		int frame = 0;
+		BOOST_LEAF_CHECK(bench_harness::run_frames(k_warmup_frames, [&]() { demo_ui(frame++); }));
+
+		for (int i = 0; i < k_test_frames; ++i)
+		{
+			const uint64_t new_before	= g_new_count.load(std::memory_order_relaxed);
+			const uint64_t imgui_before = imgui_allocation_count();
+
+			BOOST_LEAF_CHECK(bench_harness::run_frames(1, [&]() { demo_ui(frame++); }));
+
+			const uint64_t new_count   = g_new_count.load(std::memory_order_relaxed) - new_before;
+			const uint64_t imgui_count = imgui_allocation_count() - imgui_before;
+			if (new_count != 0 || imgui_count != 0)
+			{
+				if (failed_frames < k_max_reported)
+				{
+					std::printf("frame %d: %llu operator new, %llu ImGui allocations\n", i, (unsigned long long)new_count, (unsigned long long)imgui_count);
+				}
+				++failed_frames;
+			}
+		}
+		return {};
+	});
+
+	std::printf("%d of %d frames allocated\n", failed_frames, k_test_frames);
+	return exit_code != 0 || failed_frames != 0 ? 1 : 0;
+}